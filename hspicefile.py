@@ -8,13 +8,49 @@ to Python3 by Trey Greer
 """
 
 import _hspice_read
-from numpy import array
+from numpy import array, arange, atleast_1d, asarray, nonzero
 from time import strftime
 
-__all__ = [ 'hspice_read' ]
+__all__ = [ 'hspice_read', 'hspice_compare', 'hspice_stats', 
+	'hspice_arrow', 'sweep_range', 'Reader' ]
 
-def hspice_read(filename, debug=0):
+def sweep_range(low, high):
 	"""
+	Returns a sweep selection for :func:`hspice_read` that picks the sweeps 
+	whose parameter value lies in the closed interval [*low*, *high*]. 
+	"""
+	return lambda values: (values >= low) & (values <= high)
+
+def _sweep_selector(sweeps):
+	"""
+	Converts the *sweeps* argument of :func:`hspice_read` into a callable that 
+	receives the array of all sweep parameter values and returns a list of 
+	table indices. 
+	"""
+	def select(values):
+		if callable(sweeps):
+			selected=asarray(sweeps(values))
+			if selected.dtype == bool:
+				selected=nonzero(selected)[0]
+		else:
+			selected=arange(len(values))[sweeps]
+		return atleast_1d(selected).tolist()
+	return select
+
+def hspice_read(filename, debug=0, sweeps=None, threads=0):
+	"""
+	Reads the HSPICE binary file *filename*. 
+	
+	*sweeps* selects the sweep tables to read. It can be a table index, a 
+	sequence of table indices, a slice, or a callable that receives the array 
+	of all sweep parameter values and returns table indices or a boolean mask 
+	(see :func:`sweep_range`). Tables that are not selected are skipped without 
+	being decoded. ``None`` reads all tables. *sweeps* is ignored if no 
+	variable was swept. 
+	
+	Large tables are split into row ranges that are decoded in parallel on 
+	*threads* threads (0 uses one thread per processor). 
+	
 	Returns a list with only one tuple as member (representing the results of 
 	one analysis). 
 	
@@ -26,7 +62,8 @@ def hspice_read(filename, debug=0):
 	  sweep
 	    
 		0. The name of the swept parameter
-		1. An array with the N values of the parameter
+		1. An array with the N values of the parameter (only the selected 
+		   values if *sweeps* is given)
 		2. A list with N dictionaries, one for every parameter value holding 
 		   the simulation results where result name is the key and values are 
 		   arrays. 
@@ -47,4 +84,188 @@ def hspice_read(filename, debug=0):
 	
 	Returns ``None`` if an error occurs during reading. 
 	"""
-	return _hspice_read.hspice_read(filename, debug)
+	if sweeps is None:
+		return _hspice_read.hspice_read(filename, debug, None, threads)
+	return _hspice_read.hspice_read(filename, debug, _sweep_selector(sweeps), 
+		threads)
+
+class Reader(_hspice_read.Reader):
+	"""
+	HSPICE binary file reader for reading many files in a row. 
+	
+	The reader keeps its scratch buffers between reads and remembers the 
+	vector names of the last file header. Files with the same vectors are read 
+	without reallocating buffers or parsing the vector names again. A reader 
+	must not be used by more than one thread at a time, a call made while 
+	another thread is reading raises :exc:`RuntimeError`. 
+	
+	The scratch buffers grow to the size of the largest table read so far. 
+	If they are larger than *max_scratch* bytes after a read they are 
+	released (0 keeps them regardless of size). :meth:`clear` releases them 
+	at any time. 
+	
+	*debug* turns on debug messages. Large tables are decoded in parallel on 
+	*threads* threads (0 uses one thread per processor). 
+	"""
+	def __init__(self, debug=0, threads=0, max_scratch=0):
+		_hspice_read.Reader.__init__(self, debug, threads, max_scratch)
+	
+	def clear(self):
+		"""
+		Releases the scratch buffers and forgets the cached vector names. 
+		"""
+		_hspice_read.Reader.clear(self)
+	
+	def scratch_size(self):
+		"""
+		Returns the size of the scratch buffers in bytes. 
+		"""
+		return _hspice_read.Reader.scratch_size(self)
+	
+	def read(self, filename, sweeps=None):
+		"""
+		Reads the HSPICE binary file *filename*. Arguments and return value 
+		are the same as those of :func:`hspice_read`. 
+		"""
+		if sweeps is None:
+			return _hspice_read.Reader.read(self, filename)
+		return _hspice_read.Reader.read(self, filename, _sweep_selector(sweeps))
+	
+	def read_into(self, filename, out, sweep_values=None):
+		"""
+		Reads the HSPICE binary file *filename* into preallocated arrays. 
+		
+		*out* is a list with one dictionary per sweep table (one dictionary if 
+		no variable was swept). The keys are vector names and the values are 
+		writeable 1-D arrays of type ``float64`` (``complex128`` for complex 
+		vectors) that are long enough to hold the table. Only the listed 
+		vectors are decoded. *sweep_values* is an optional ``float64`` array 
+		that receives the values of the swept parameter. 
+		
+		Once the buffers of the reader are large enough no memory is 
+		allocated apart from the returned list. 
+		
+		Returns a list with the number of rows of every table. 
+		"""
+		return _hspice_read.Reader.read_into(self, filename, out, sweep_values)
+
+def hspice_compare(filename_a, filename_b, rtol=1e-3, atol=1e-6, signals=None, 
+	threads=0, debug=0):
+	"""
+	Compares two HSPICE binary files without loading them into memory. 
+	*filename_a* is the reference (golden) file. 
+	
+	Both files are read block by block. Tables belonging to different sweep 
+	points are compared in parallel on *threads* threads (0 uses one thread 
+	per processor). If the scale points of the two files differ the values of 
+	*filename_b* are linearly interpolated to the scale points of 
+	*filename_a*. Scales must be increasing. Tables whose sweep values differ 
+	by more than *rtol* or whose scale ranges differ by more than *rtol* 
+	times the scale span (one table is shorter or longer than the other) 
+	fail and are reported as mismatched. 
+	
+	A value passes if ``abs(b-a) <= atol + rtol*abs(a)``. NaN values never 
+	pass and are reported as the maximal error. *signals* is a list 
+	of vector names to compare. By default all vectors of *filename_a* 
+	except the scale are compared. 
+	
+	Returns a tuple with the following members
+	
+	0. ``True`` if all signals passed in all sweeps
+	1. An array with the values of the swept parameter or ``None`` if no 
+	   variable was swept
+	2. A list with one tuple per sweep. The tuple holds the pass flag of the 
+	   sweep, a dictionary with signal names for keys, and a string 
+	   describing how the tables do not correspond (``None`` if they do). 
+	   The values of the dictionary are tuples holding the maximal absolute 
+	   error of the signal and the scale value where the signal failed 
+	   first (``None`` if it passed). 
+	
+	Returns ``None`` if an error occurs during reading. 
+	"""
+	return _hspice_read.hspice_compare(filename_a, filename_b, rtol, atol, 
+		debug, signals, threads)
+
+def hspice_stats(filename, signals=None, quantiles=(0.05, 0.5, 0.95), 
+	threads=0, debug=0):
+	"""
+	Computes statistics of signals across all sweeps of the HSPICE binary 
+	file *filename* (e.g. the samples of a Monte Carlo analysis) without 
+	loading the sweeps into memory. 
+	
+	Every sweep table is folded into running statistics as it is read so 
+	memory use does not depend on the number of sweeps. Mean and standard 
+	deviation are computed with Welford's method. Quantiles are taken from a 
+	mergeable sketch with 32 items per requested quantile plus 32 at every 
+	scale point (about 1kB for three quantiles). Quantiles are exact (as 
+	computed by ``numpy.quantile``) while the number of sweeps does not 
+	exceed the number of sketch items and approximate beyond that. Items 
+	close to the requested quantiles are kept finer than the others. 
+	Tables are folded in parallel on *threads* 
+	threads (0 uses one thread per processor) and the partial results are 
+	merged at the end. Fewer threads are used if the partial results of all 
+	threads would need more than 1GB of memory. 
+	
+	Tables are interpolated to the scale points of the first table. Complex 
+	vectors are summarized by their magnitude. *signals* is a list of vector 
+	names, by default all vectors except the scale are summarized. 
+	*quantiles* lists the quantiles to estimate (between 0 and 1). 
+	
+	Returns a tuple with the following members
+	
+	0. The name of the scale vector
+	1. An array with the scale points
+	2. The number of sweeps (samples)
+	3. A dictionary with signal names for keys. Every value is a dictionary 
+	   with arrays under keys ``mean``, ``std`` (sample standard deviation), 
+	   ``min``, ``max`` and ``quantiles``. The ``quantiles`` array has one row 
+	   per requested quantile. 
+	
+	Returns ``None`` if an error occurs during reading. 
+	"""
+	result=_hspice_read.hspice_stats(filename, debug, list(quantiles), 
+		signals, threads)
+	if result is None:
+		return None
+	scale, values, samples, stats = result
+	keys = ( 'mean', 'std', 'min', 'max', 'quantiles' )
+	return scale, values, samples, dict(
+		(name, dict(zip(keys, arrays))) for name, arrays in stats.items()
+	)
+
+class ArrowStream(object):
+	"""
+	HSPICE binary file exported through the Arrow PyCapsule interface. 
+	
+	Arrow consumers (e.g. ``pyarrow.table()``, ``polars.DataFrame()``) read 
+	the file as a stream of record batches, one per sweep table. Tables are 
+	decoded when the consumer asks for them, directly into the column buffers 
+	that are handed over to the consumer. No Arrow library is needed. 
+	
+	All columns are ``float64``. The first column holds the value of the 
+	swept parameter if a variable was swept and *sweep_column* is ``True``. 
+	It is followed by the scale and the remaining vectors. Complex vectors 
+	are exported as two columns, ``real(name)`` and ``imag(name)``. 
+	
+	The stream can be consumed more than once, every consumer reads the 
+	file again. 
+	"""
+	def __init__(self, filename, sweep_column=True, debug=0):
+		self.filename = filename
+		self.sweep_column = sweep_column
+		self.debug = debug
+	
+	def __arrow_c_stream__(self, requested_schema=None):
+		stream = _hspice_read.hspice_arrow(self.filename, self.debug, 
+			1 if self.sweep_column else 0)
+		if stream is None:
+			raise IOError("failed to read %s" % self.filename)
+		return stream
+
+def hspice_arrow(filename, sweep_column=True, debug=0):
+	"""
+	Returns an :class:`ArrowStream` for the HSPICE binary file *filename*. 
+	With *sweep_column* the sweep tables form one table with the value of 
+	the swept parameter in the first column. 
+	"""
+	return ArrowStream(filename, sweep_column, debug)
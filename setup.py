@@ -8,6 +8,7 @@ import os
 # Detect platform, set up include directories and preprocessor macros 
 define_macros=[('LINUX', None)]
 include_dirs=[os.path.join(numpy.get_include(), 'numpy')]
+libraries=['pthread']
 	
 # Extensions
 ext_modules=[
@@ -15,6 +16,7 @@ ext_modules=[
 		'_hspice_read', 
 		['src/hspice_read.c'], 
 		include_dirs=include_dirs,
+		libraries=libraries,
 		define_macros=define_macros
 	) 
 ]
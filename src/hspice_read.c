@@ -37,6 +37,9 @@ error_out(PyObject *m) {
 static PyMethodDef _hspice_read_methods[] =
 {
 	{"hspice_read", HSpiceRead, METH_VARARGS},
+	{"hspice_compare", HSpiceCompare, METH_VARARGS},
+	{"hspice_stats", HSpiceStats, METH_VARARGS},
+	{"hspice_arrow", HSpiceArrow, METH_VARARGS},
         {"error_out", (PyCFunction)error_out, METH_NOARGS, NULL},
 	{NULL, NULL}	// Marks the end of this structure.
 };
@@ -78,6 +81,17 @@ __declspec(dllexport) PyObject *PyInit__hspice_read()
 	}
 
 	import_array();  // Must be present for NumPy.
+
+	if (PyType_Ready(&ReaderType) < 0) {
+	    Py_DECREF(module);
+	    return NULL;
+	}
+	Py_INCREF(&ReaderType);
+	if (PyModule_AddObject(module, "Reader", (PyObject *)&ReaderType) < 0) {
+	    Py_DECREF(&ReaderType);
+	    Py_DECREF(module);
+	    return NULL;
+	}
 	return module;
 }
 
@@ -106,13 +120,22 @@ __declspec(dllexport) PyObject *PyInit__hspice_read()
 #define complex_var						1
 #define real_var						0
 
+// Parallel decoding of table rows, sizes in numbers
+#define decodeRangeSize					65536
+#define parallelDecodeSize				1048576
+
+// Quantile sketch items per requested quantile, memory for partial
+// statistics in bytes
+#define sketchItemsPerQuantile			32
+#define statsMemorySize					1073741824.0
+
 // Perform endian swap on array of numbers. Arguments:
 //   block    ... pointer to array of numbers
 //   size     ... size of the array
 //   itemSize ... size of one number in the array in bytes
-void do_swap(char *block, int size, int itemSize)
+void do_swap(char *block, size_t size, int itemSize)
 {
-	int i;
+	size_t i;
 	for(i = 0; i < size; i++)
 	{
 		int j;
@@ -175,9 +198,9 @@ int readBlockHeader(FILE *f, const char *fileName, int debugMode, int *blockHead
 //   numOfItems  ... number of items in block
 //   swap        ... perform endian swap flag
 int readBlockData(FILE *f, const char *fileName, int debugMode, void *ptr,
-					size_t *offset, int itemSize, int numOfItems, int swap)
+					size_t *offset, int itemSize, size_t numOfItems, int swap)
 {
-	int num = fread(ptr, itemSize, numOfItems, f);
+	size_t num = fread(ptr, itemSize, numOfItems, f);
 	if(num != numOfItems)
 	{
 		if(debugMode) fprintf(debugFile,
@@ -224,7 +247,8 @@ int readBlockTrailer(FILE *f, const char *fileName, int debugMode, int swap,
 	return 0;
 }
 
-// Reallocate space. Returns:
+// Reallocate space. The raw allocator is used so that the space can be
+// used, grown and released without the GIL. Returns:
 // 	 NULL    ... reallocation failed
 //   pointer ... address of reallocated space
 // Arguments:
@@ -234,12 +258,36 @@ int readBlockTrailer(FILE *f, const char *fileName, int debugMode, int swap,
 void *reallocate(int debugMode, void *ptr, size_t size)
 {
 	// Allocate space for raw data.
-	void *tmp = PyMem_Realloc(ptr, size);
+	void *tmp = PyMem_RawRealloc(ptr, size);
 	if(tmp == NULL && debugMode)
 		fprintf(debugFile, "HSpiceRead: cannot allocate.\n");
 	return tmp;
 }
 
+// Make sure allocated space is large enough. The space grows by at least one
+// half of its current size so that growing it block by block does not
+// reallocate it every time. The space must be released with PyMem_RawFree().
+// Returns:
+//   0 ... performed normally
+//   1 ... reallocation failed
+// Arguments:
+//   debugMode ... debug messages flag
+//   ptr       ... pointer to pointer to already allocated space
+//   size      ... pointer to size of allocated space in bytes
+//   required  ... required size in bytes
+int ensureSpace(int debugMode, void **ptr, size_t *size, size_t required)
+{
+	void *tmp;
+	size_t newSize = *size + *size / 2;
+	if(required <= *size) return 0;
+	if(newSize < required) newSize = required;
+	tmp = reallocate(debugMode, *ptr, newSize);
+	if(tmp == NULL) return 1;
+	*ptr = tmp;
+	*size = newSize;
+	return 0;
+}
+
 // Read one file header block. Returns:
 //   -1 ... this was the last block
 //    0 ... there is at least one more block left
@@ -249,12 +297,12 @@ void *reallocate(int debugMode, void *ptr, size_t size)
 //   debugMode ... debug messages flag
 //   fileName  ... name of the file
 //   buf       ... pointer to header buffer,
-//                 enlarged (reallocated) for current block
+//                 enlarged (reallocated) for current block if needed
+//   bufSize   ... pointer to allocated size of header buffer
 //   bufOffset ... pointer to buffer size, increased for current block size
 int readHeaderBlock(FILE *f, int debugMode, const char *fileName, char **buf,
-					size_t *bufOffset)
+					size_t *bufSize, size_t *bufOffset)
 {
-	char *tmpBuf;
 	int error, blockHeader[blockHeaderSize], swap;
 
 	// Get size of file header block.
@@ -262,10 +310,9 @@ int readHeaderBlock(FILE *f, int debugMode, const char *fileName, char **buf,
 	if(swap < 0) return 1;	// Error.
 
 	// Allocate space for buffer.
-	tmpBuf = reallocate(debugMode, *buf,
+	error = ensureSpace(debugMode, (void **)buf, bufSize,
 						(*bufOffset + blockHeader[0] + 1) * sizeof(char));
-	if(tmpBuf == NULL) return 1;	// Error.
-	*buf = tmpBuf;
+	if(error == 1) return 1;	// Error.
 
 	// Read file header block.
 	error = readBlockData(f, fileName, debugMode, *buf + *bufOffset, bufOffset,
@@ -283,29 +330,247 @@ int readHeaderBlock(FILE *f, int debugMode, const char *fileName, char **buf,
 	return 0;	// There is more.
 }
 
-// Get sweep infornation from file header block. Returns:
+// Read header blocks of a file into a buffer. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   f         ... pointer to file for reading, positioned at the beginning
+//   debugMode ... debug messages flag
+//   fileName  ... name of the file
+//   buf       ... pointer to header buffer, enlarged (reallocated) if needed
+//   bufSize   ... pointer to allocated size of header buffer
+//   length    ... acquired length of header text
+int readHeaderText(FILE *f, int debugMode, const char *fileName, char **buf,
+				   size_t *bufSize, size_t *length)
+{
+	int num;
+	*length = 0;
+
+	num = getc(f);
+	ungetc(num, f);
+	if(num == EOF)	// Test if there is data in the file.
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: file %s is empty.\n", fileName);
+		return 1;
+	}
+	if((num & 0x000000ff) >= ' ')	// Test if the file is in binary format.
+	{
+		if(debugMode) fprintf(debugFile,
+							  "HSpiceRead: file %s is in ascii format.\n",
+							  fileName);
+		return 1;
+	}
+
+	// Read file header blocks.
+	do num = readHeaderBlock(f, debugMode, fileName, buf, bufSize, length);
+	while(num == 0);
+	if(num > 0) return 1;
+
+	if(*length <= vectorDescriptionStartPosition)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: file header too short.\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+// Parse fields at fixed positions of the file header. Vector descriptions are
+// not parsed. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   debugMode ... debug messages flag
+//   buf       ... header text
+//   header    ... parsed header
+int parseHeaderFields(int debugMode, char *buf, struct FileHeader *header)
+{
+	int i = dateStartPosition - 1;
+
+ 	// Check version of post format.
+	if(strncmp(&buf[postStartPosition1], postString11, numOfPostCharacters) != 0 &&
+	   strncmp(&buf[postStartPosition1], postString12, numOfPostCharacters) != 0 &&
+	   strncmp(&buf[postStartPosition2], postString21, numOfPostCharacters) != 0)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: unknown post format.\n");
+		return 1;
+	}
+
+	// Get number of sweep points.
+	if(strncmp(&buf[postStartPosition2], postString21, numOfPostCharacters) != 0)
+		header->sweepSize = atoi(&buf[sweepSizePosition1]);
+	else header->sweepSize = atoi(&buf[sweepSizePosition2]);
+
+	buf[dateEndPosition] = 0;
+	header->date = &buf[dateStartPosition];	// Get creation date.
+
+	while(buf[i] == ' ') i--;
+	buf[i + 1] = 0;
+	header->title = &buf[titleStartPosition];	// Get title.
+
+	buf[numOfSweepsEndPosition] = 0;	// Check number of sweep parameters.
+	header->numOfSweeps = atoi(&buf[numOfSweepsPosition]);
+	if(header->numOfSweeps < 0 || header->numOfSweeps > 1)
+	{
+		if(debugMode) fprintf(debugFile,
+							  "HSpiceRead: only onedimensional sweep supported.\n");
+		return 1;
+	}
+	if(header->numOfSweeps == 0) header->sweepSize = 1;
+
+	buf[numOfSweepsPosition] = 0;	// Get number of vectors (variables and probes).
+	header->numOfVectors = atoi(&buf[numOfProbesPosition]);
+	buf[numOfProbesPosition] = 0;
+	header->numOfVariables = atoi(&buf[numOfVariablesPosition]);	// Scale included.
+	header->numOfVectors = header->numOfVectors + header->numOfVariables;
+	if(header->numOfVectors < 1)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: no vectors in file.\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+// Parse vector descriptions of the file header. Vector names are converted to
+// lowercase and 'v(' is removed from the front of them. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   debugMode ... debug messages flag
+//   text      ... vector descriptions, tokenized in place
+//   header    ... header with parsed fixed position fields, name must have
+//                 space for numOfVectors pointers
+int parseVectorNames(int debugMode, char *text, struct FileHeader *header)
+{
+	char *token;
+	int i;
+
+	// Get type of variables. Scale is always real.
+	token = strtok(text, " \t\n");
+	if(token != NULL && atoi(token) == frequency) header->type = complex_var;
+	else header->type = real_var;
+
+	for(i = 0; i < header->numOfVectors && token != NULL; i++)
+		token = strtok(NULL, " \t\n");
+	if(token == NULL)
+	{
+		if(debugMode) fprintf(debugFile,
+							  "HSpiceRead: failed to extract independent variable name.\n");
+		return 1;
+	}
+	header->scale = token;	// Get independent variable name.
+
+	for(i = 0; i < header->numOfVectors - 1; i++)	// Get vector names.
+	{
+		header->name[i] = strtok(NULL, " \t\n");
+		if(header->name[i] == NULL)
+		{
+			if(debugMode) fprintf(debugFile,
+								  "HSpiceRead: failed to extract vector names.\n");
+			return 1;
+		}
+	}
+
+	// Process vector names: make name lowercase, remove v( in front of name
+	for(i=0; i < header->numOfVectors - 1; i++) {
+		int j;
+		char *name = header->name[i];
+		for(j=0;name[j];j++) {
+			if (name[j]>='A' && name[j]<='Z') {
+				name[j]-='A'-'a';
+			}
+		}
+		if (name[0]=='v' && name[1]=='(') {
+			for(j=2;name[j];j++) {
+				name[j-2]=name[j];
+			}
+			name[j-2]=0;
+		}
+	}
+
+	header->sweep = NULL;
+	if(header->numOfSweeps == 1)
+	{
+		header->sweep = strtok(NULL, " \t\n");	// Get sweep parameter name.
+		if(header->sweep == NULL)
+		{
+			if(debugMode)
+				fprintf(debugFile, "HSpiceRead: failed to extract sweep name.\n");
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// Read and parse the file header. All strings in the parsed header point into
+// the header buffer. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   f         ... pointer to file for reading, positioned at the beginning
+//   debugMode ... debug messages flag
+//   fileName  ... name of the file
+//   header    ... parsed header, must be released with freeFileHeader()
+int readFileHeader(FILE *f, int debugMode, const char *fileName,
+				   struct FileHeader *header)
+{
+	size_t bufSize = 0, length;
+
+	header->buf = NULL;
+	header->name = NULL;
+
+	if(readHeaderText(f, debugMode, fileName, &header->buf, &bufSize, &length))
+		goto readFileHeaderFailed;
+	if(parseHeaderFields(debugMode, header->buf, header))
+		goto readFileHeaderFailed;
+
+	// Allocate space for pointers to vector names.
+	header->name = (char **)PyMem_Malloc(header->numOfVectors * sizeof(char *));
+	if(header->name == NULL)
+	{
+		if(debugMode) fprintf(debugFile,
+							  "HSpiceRead: cannot allocate pointers to vector names.\n");
+		goto readFileHeaderFailed;
+	}
+
+	if(parseVectorNames(debugMode, &header->buf[vectorDescriptionStartPosition],
+						header))
+		goto readFileHeaderFailed;
+
+	return 0;
+
+readFileHeaderFailed:
+	freeFileHeader(header);
+	return 1;
+}
+
+// Release memory held by a parsed file header. Arguments:
+//   header ... parsed header
+void freeFileHeader(struct FileHeader *header)
+{
+	PyMem_RawFree(header->buf);
+	header->buf = NULL;
+	PyMem_Free(header->name);
+	header->name = NULL;
+}
+
+// Get sweep infornation from file header. Returns:
 //   0 ... performed normally
 //   1 ... error occurred
 // Arguments:
 //   debugMode   ... debug messages flag
 //   sweep       ... acquired sweep parameter name, new reference created
-//   buf         ... header string
-//   sweepSize   ... acquired number of sweep points
+//   header      ... parsed file header
 //   sweepValues ... sweep points array, new reference created
 //   faSweep     ... pointer to fast access structure for sweep array
-int getSweepInfo(int debugMode, PyObject **sweep, char *buf, int *sweepSize,
+int getSweepInfo(int debugMode, PyObject **sweep, struct FileHeader *header,
 				 PyObject **sweepValues, struct FastArray *faSweep)
 {
-	char *sweepName = NULL;
 	npy_intp dims;
-	sweepName = strtok(NULL, " \t\n");	// Get sweep parameter name.
-	if(sweepName == NULL)
-	{
-		if(debugMode)
-			fprintf(debugFile, "HSpiceRead: failed to extract sweep name.\n");
-		return 1;
-	}
-	*sweep = PyUnicode_FromString(sweepName);
+	*sweep = PyUnicode_FromString(header->sweep);
 	if(*sweep == NULL)
 	{
 		if(debugMode)
@@ -313,13 +578,8 @@ int getSweepInfo(int debugMode, PyObject **sweep, char *buf, int *sweepSize,
 		return 1;
 	}
 
-	// Get number of sweep points.
-	if(strncmp(&buf[postStartPosition2], postString21, numOfPostCharacters) != 0)
-		*sweepSize = atoi(&buf[sweepSizePosition1]);
-	else *sweepSize = atoi(&buf[sweepSizePosition2]);
-
 	// Create array for sweep parameter values.
-	dims=*sweepSize;
+	dims=header->sweepSize;
 	*sweepValues = PyArray_SimpleNew(1, &dims, PyArray_DOUBLE);
 	if(*sweepValues == NULL)
 	{
@@ -347,23 +607,22 @@ int getSweepInfo(int debugMode, PyObject **sweep, char *buf, int *sweepSize,
 //   debugMode     ... debug messages flag
 //   fileName      ... name of the file
 //   rawData       ... pointer to data array,
-//                     enlarged (reallocated) for current block
+//                     enlarged (reallocated) for current block if needed
+//   rawDataSize   ... pointer to allocated size of data array in bytes
 //   rawDataOffset ... pointer to data array size, increased for current block size
 int readDataBlock(FILE *f, int debugMode, const char *fileName, float **rawData,
-				  size_t *rawDataOffset)
+				  size_t *rawDataSize, size_t *rawDataOffset)
 {
 	int error, blockHeader[blockHeaderSize], swap;
-	float *tmpRawData;
 
 	// Get size of raw data block.
 	swap = readBlockHeader(f, fileName, debugMode, blockHeader, sizeof(float));
 	if(swap < 0) return 1;	// Error.
 
 	// Allocate space for raw data.
-	tmpRawData = reallocate(debugMode, *rawData,
-							(*rawDataOffset + blockHeader[0]) * sizeof(float));
-	if(tmpRawData == NULL) return 1;	// Error.
-	*rawData = tmpRawData;
+	error = ensureSpace(debugMode, (void **)rawData, rawDataSize,
+						(*rawDataOffset + blockHeader[0]) * sizeof(float));
+	if(error == 1) return 1;	// Error.
 
 	// Read raw data block.
 	error = readBlockData(f, fileName, debugMode, *rawData + *rawDataOffset,
@@ -380,143 +639,1288 @@ int readDataBlock(FILE *f, int debugMode, const char *fileName, float **rawData,
 	return 0;	// There is more.
 }
 
-// Read one table for one sweep value. Returns:
-//   0 ... performed normally
-//   1 ... error occurred
+// Skip one data block without reading its contents. Only the first (optional)
+// and the last number in the block are read. Returns:
+//   -1 ... this was the last block
+//    0 ... there is at least one more block left
+//    1 ... error occured during skipping the block
 // Arguments:
-//   f              ... pointer to file for reading
-//   debugMode      ... debug messages flag
-//   fileName       ... name of the file
-//   sweep          ... sweep parameter name
-//   numOfVariables ... number of variables in table
-//   type           ... type of variables with exeption of scale 
-//   numOfVectors   ... number of variables and probes in table
-//   faSweep        ... pointer to fast access structure for sweep array
-//   tmpArray       ... array of pointers to arrays
-//   faPtr          ... array of fast access structures for vector arrays
-//   scale          ... scale name
-//   name           ... array of vector names
-//   dataList       ... list of data dictionaries
-int readTable(FILE *f, int debugMode, const char *fileName, PyObject *sweep,
-			  int numOfVariables, int type, int numOfVectors,
-			  struct FastArray *faSweep, PyObject **tmpArray,
-			  struct FastArray *faPtr, char *scale, char **name, PyObject *dataList)
+//   f         ... pointer to file for reading
+//   debugMode ... debug messages flag
+//   fileName  ... name of the file
+//   first     ... pointer to space for the first number in the block,
+//                 NULL if it is not needed
+//   count     ... pointer to number of numbers, increased by block size,
+//                 NULL if it is not needed
+int skipDataBlock(FILE *f, int debugMode, const char *fileName, float *first,
+				  size_t *count)
 {
-	int i, j, num, numOfColumns = numOfVectors;
-    size_t offset = 0;
-	npy_intp dims;
-	float *rawDataPos, *rawData = NULL;
-	PyObject *data = NULL; 
-
-	// Read raw data blocks.
-	do num = readDataBlock(f, debugMode, fileName, &rawData, &offset);
-	while(num == 0);
-	if(num > 0) goto readTableFailed;
+	int error, blockHeader[blockHeaderSize], swap, remaining;
+	float last;
 
-	data = PyDict_New();	// Create an empty dictionary.
-	if(data == NULL)
+	// Get size of raw data block.
+	swap = readBlockHeader(f, fileName, debugMode, blockHeader, sizeof(float));
+	if(swap < 0) return 1;	// Error.
+	remaining = blockHeader[0];
+	if(remaining < 1)
 	{
-		if(debugMode)
-			fprintf(debugFile, "HSpiceRead: failed to create data dictionary.\n");
-		goto readTableFailed;
+		if(debugMode) fprintf(debugFile, "HSpiceRead: empty data block.\n");
+		return 1;	// Error.
 	}
+	if(count != NULL) *count = *count + remaining;
 
-	// Increase number of columns if variables with exeption of scale are complex.
-	if(type == complex_var) numOfColumns = numOfColumns + numOfVariables - 1;
-
-	rawDataPos = rawData;
-	if(sweep == NULL) num = (offset - 1) / numOfColumns;	// Number of rows.
-	else
+	if(first != NULL)	// Read the first number.
 	{
-		num = (offset - 2) / numOfColumns;
-		*((npy_double *)(faSweep->pos)) = *rawDataPos;	// Save sweep value.
-		rawDataPos = rawDataPos + 1;
-		faSweep->pos = faSweep->pos + faSweep->stride;
+		if(fread(first, sizeof(float), 1, f) != 1)
+		{
+			if(debugMode) fprintf(debugFile,
+								  "HSpiceRead: failed to read block from file %s.\n",
+								  fileName);
+			return 1;	// Error.
+		}
+		if(swap > 0) do_swap((char *)first, 1, sizeof(float));	// Endian swap.
+		last = *first;
+		remaining = remaining - 1;
 	}
 
-	for(i = 0; i < numOfVectors; i++)
+	if(remaining > 0)	// Skip to the last number and read it.
 	{
-		// Create array for i-th vector.
-		dims=num;
-		if(type == complex_var && i > 0 && i < numOfVariables)
-			tmpArray[i] = PyArray_SimpleNew(1, &dims, PyArray_CDOUBLE);
-		else
-			tmpArray[i] = PyArray_SimpleNew(1, &dims, PyArray_DOUBLE);
-		if(tmpArray[i] == NULL)
+		if(fileSeek(f, (FileOffset)(remaining - 1) * sizeof(float), SEEK_CUR) != 0 ||
+		   fread(&last, sizeof(float), 1, f) != 1)
 		{
-			if(debugMode)
-				fprintf(debugFile, "HSpiceRead: failed to create array.\n");
-			for(j = 0; j < i + 1; j++) Py_XDECREF(tmpArray[j]);
-			goto readTableFailed;
+			if(debugMode) fprintf(debugFile,
+								  "HSpiceRead: failed to skip block in file %s.\n",
+								  fileName);
+			return 1;	// Error.
 		}
+		if(swap > 0) do_swap((char *)(&last), 1, sizeof(float));	// Endian swap.
 	}
 
-	for(i = 0; i < numOfVectors; i++)	// Prepare fast access structures.
-	{
-		faPtr[i].data = ((PyArrayObject *)(tmpArray[i]))->data;
-		faPtr[i].pos = ((PyArrayObject *)(tmpArray[i]))->data;
-		faPtr[i].stride =
-			((PyArrayObject *)(tmpArray[i]))->strides[((PyArrayObject *)(tmpArray[i]))->nd -
-			1];
-		faPtr[i].length = PyArray_Size(tmpArray[i]);
-	}
+	// Read trailer of raw data block.
+	error = readBlockTrailer(f, fileName, debugMode, swap,
+							 blockHeader[blockHeaderSize - 1]);
+	if(error == 1) return 1;	// Error.
+
+	if(last > 9e29) return -1;	// End of block.
+
+	return 0;	// There is more.
+}
+
+// Scan all tables in the file without decoding them. Records the file position
+// where every table starts, its size and its sweep value. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   f           ... pointer to file for reading
+//   debugMode   ... debug messages flag
+//   fileName    ... name of the file
+//   sweepSize   ... number of tables in the file
+//   tableOffset ... array of sweepSize file positions
+//   tableSize   ... array of sweepSize numbers of numbers in tables, NULL if
+//                   not needed
+//   faSweep     ... pointer to fast access structure for sweep array
+int scanTables(FILE *f, int debugMode, const char *fileName, int sweepSize,
+			   FileOffset *tableOffset, size_t *tableSize,
+			   struct FastArray *faSweep)
+{
+	int i, num;
+	size_t size;
+	float value;
 
-	for(i = 0; i < num; i++)	// Save raw data.
+	for(i = 0; i < sweepSize; i++)
 	{
-		struct FastArray *faPos = faPtr;
-		for(j = 0; j < numOfVectors; j++)
+		tableOffset[i] = fileTell(f);
+		if(tableOffset[i] < 0)
 		{
-			if(type == complex_var && j > 0 && j < numOfVariables)
-			{
-				((npy_cdouble *)(faPos->pos))->real = *rawDataPos;
-				rawDataPos = rawDataPos + 1;
-				((npy_cdouble *)(faPos->pos))->imag = *rawDataPos;
-			} else *((npy_double *)(faPos->pos)) = *rawDataPos;
-			rawDataPos = rawDataPos + 1;
-			faPos->pos = faPos->pos + faPos->stride;
-			faPos = faPos + 1;
+			if(debugMode) fprintf(debugFile,
+								  "HSpiceRead: failed to get position in file %s.\n",
+								  fileName);
+			return 1;
 		}
-	}
-	PyMem_Free(rawData);
-	rawData = NULL;
 
-	// Insert vectors into dictionary.
-	num = PyDict_SetItemString(data, scale, tmpArray[0]);
-	i = -1;
-	if(num == 0) for(i = 0; i < numOfVectors - 1; i++)
-	{
-		num = PyDict_SetItemString(data, name[i], tmpArray[i + 1]);
-		if(num != 0) break;
-	}
-	for(j = 0; j < numOfVectors; j++) Py_XDECREF(tmpArray[j]);
-	if(num)
-	{
-	  if(debugMode) {
-	    if(i == -1)
-	      fprintf(debugFile, "HSpiceRead: failed to insert vector %s into dictionary.\n", scale);
-	    else
-	      fprintf(debugFile, "HSpiceRead: failed to insert vector %s into dictionary.\n", name[i]);
-	  }
-	  goto readTableFailed;
+		// First number of the first block is the sweep value.
+		size = 0;
+		num = skipDataBlock(f, debugMode, fileName, &value, &size);
+		while(num == 0) num = skipDataBlock(f, debugMode, fileName, NULL, &size);
+		if(num > 0) return 1;
+		if(tableSize != NULL) tableSize[i] = size;
+
+		*((npy_double *)(faSweep->pos)) = value;	// Save sweep value.
+		faSweep->pos = faSweep->pos + faSweep->stride;
 	}
 
-	// Insert table into the list of data dictionaries.
-	num = PyList_Append(dataList, data);
+	return 0;
+}
+
+// Read all raw data blocks of one table into scratch space. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   f         ... pointer to file for reading
+//   debugMode ... debug messages flag
+//   fileName  ... name of the file
+//   buffers   ... scratch space, raw data array is enlarged if needed
+//   count     ... acquired number of numbers in the table
+int readRawTable(FILE *f, int debugMode, const char *fileName,
+				 struct ReadBuffers *buffers, size_t *count)
+{
+	int num;
+	*count = 0;
+	do num = readDataBlock(f, debugMode, fileName, &buffers->rawData,
+						   &buffers->rawDataSize, count);
+	while(num == 0);
+	return num > 0;
+}
+
+// Make sure scratch space has room for per-vector arrays. Returns:
+//   0 ... performed normally
+//   1 ... allocation failed
+// Arguments:
+//   debugMode    ... debug messages flag
+//   buffers      ... scratch space
+//   numOfVectors ... number of variables and probes in table
+int reserveVectors(int debugMode, struct ReadBuffers *buffers, int numOfVectors)
+{
+	if(ensureSpace(debugMode, (void **)&buffers->tmpArray, &buffers->tmpArraySize,
+				   numOfVectors * sizeof(PyObject *)) ||
+	   ensureSpace(debugMode, (void **)&buffers->faPtr, &buffers->faPtrSize,
+				   numOfVectors * sizeof(struct FastArray)))
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: cannot allocate pointers to arrays.\n");
+		return 1;
+	}
+	return 0;
+}
+
+// Release scratch space. Argument:
+//   buffers ... scratch space
+void freeReadBuffers(struct ReadBuffers *buffers)
+{
+	PyMem_RawFree(buffers->buf);
+	PyMem_RawFree(buffers->rawData);
+	PyMem_RawFree(buffers->tmpArray);
+	PyMem_RawFree(buffers->faPtr);
+	memset(buffers, 0, sizeof(struct ReadBuffers));
+}
+
+// Get size of scratch space in bytes. Argument:
+//   buffers ... scratch space
+size_t readBuffersSize(struct ReadBuffers *buffers)
+{
+	return buffers->bufSize + buffers->rawDataSize + buffers->tmpArraySize +
+		buffers->faPtrSize;
+}
+
+// Release cached header layout. Argument:
+//   cache ... header layout cache
+void freeHeaderCache(struct HeaderCache *cache)
+{
+	PyMem_RawFree(cache->text);
+	PyMem_RawFree(cache->tokens);
+	PyMem_RawFree(cache->name);
+	Py_XDECREF(cache->keys);
+	Py_XDECREF(cache->index);
+	memset(cache, 0, sizeof(struct HeaderCache));
+}
+
+// Read and parse the file header using scratch space for the header text.
+// Vector descriptions are tokenized only if they differ from the cached
+// ones. Strings in the parsed header point into the scratch space and the
+// cache, the header must not be released with freeFileHeader(). Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   f         ... pointer to file for reading, positioned at the beginning
+//   debugMode ... debug messages flag
+//   fileName  ... name of the file
+//   buffers   ... scratch space
+//   cache     ... header layout cache
+//   header    ... parsed header
+int readPooledHeader(FILE *f, int debugMode, const char *fileName,
+					 struct ReadBuffers *buffers, struct HeaderCache *cache,
+					 struct FileHeader *header)
+{
+	char *text;
+	size_t length;
+
+	if(readHeaderText(f, debugMode, fileName, &buffers->buf, &buffers->bufSize,
+					  &length))
+		return 1;
+	header->buf = buffers->buf;
+	if(parseHeaderFields(debugMode, buffers->buf, header)) return 1;
+
+	text = &buffers->buf[vectorDescriptionStartPosition];
+	length = length - vectorDescriptionStartPosition;
+	if(!cache->valid || cache->length != length ||
+	   cache->numOfVectors != header->numOfVectors ||
+	   cache->numOfVariables != header->numOfVariables ||
+	   cache->numOfSweeps != header->numOfSweeps ||
+	   memcmp(cache->text, text, length) != 0)
+	{
+		// Layout differs from the cached one, tokenize a copy of it.
+		cache->valid = 0;
+		Py_CLEAR(cache->keys);
+		Py_CLEAR(cache->index);
+		if(ensureSpace(debugMode, (void **)&cache->text, &cache->textSize, length) ||
+		   ensureSpace(debugMode, (void **)&cache->tokens, &cache->tokensSize,
+					   length + 1) ||
+		   ensureSpace(debugMode, (void **)&cache->name, &cache->nameSize,
+					   header->numOfVectors * sizeof(char *)))
+			return 1;
+		memcpy(cache->text, text, length);
+		memcpy(cache->tokens, text, length);
+		cache->tokens[length] = 0;
+		header->name = cache->name;
+		if(parseVectorNames(debugMode, cache->tokens, header)) return 1;
+
+		cache->length = length;
+		cache->numOfVectors = header->numOfVectors;
+		cache->numOfVariables = header->numOfVariables;
+		cache->numOfSweeps = header->numOfSweeps;
+		cache->type = header->type;
+		cache->scale = header->scale;
+		cache->sweep = header->sweep;
+		cache->valid = 1;
+	}
+
+	header->name = cache->name;
+	header->type = cache->type;
+	header->scale = cache->scale;
+	header->sweep = cache->sweep;
+	return 0;
+}
+
+// Create Python objects for the vector names of the cached header layout if
+// they do not exist yet. keys is a tuple of vector names with scale first,
+// index is a dictionary mapping vector names to vector indices. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   debugMode ... debug messages flag
+//   cache     ... header layout cache
+int getHeaderKeys(int debugMode, struct HeaderCache *cache)
+{
+	int i;
+	if(cache->keys != NULL) return 0;
+
+	cache->keys = PyTuple_New(cache->numOfVectors);
+	cache->index = PyDict_New();
+	if(cache->keys == NULL || cache->index == NULL) goto getHeaderKeysFailed;
+	for(i = 0; i < cache->numOfVectors; i++)
+	{
+		PyObject *key, *value;
+		int num;
+		key = PyUnicode_FromString(i == 0 ? cache->scale : cache->name[i - 1]);
+		if(key == NULL) goto getHeaderKeysFailed;
+		PyTuple_SET_ITEM(cache->keys, i, key);
+		value = PyLong_FromLong(i);
+		if(value == NULL) goto getHeaderKeysFailed;
+		num = PyDict_SetItem(cache->index, key, value);
+		Py_DECREF(value);
+		if(num) goto getHeaderKeysFailed;
+	}
+	return 0;
+
+getHeaderKeysFailed:
+	if(debugMode)
+		fprintf(debugFile, "HSpiceRead: failed to create vector name strings.\n");
+	Py_CLEAR(cache->keys);
+	Py_CLEAR(cache->index);
+	return 1;
+}
+
+// Decode one range of rows from raw data into vector arrays. Arguments:
+//   context ... pointer to DecodeJob structure
+//   index   ... index of the row range
+void decodeRows(void *context, int index)
+{
+	struct DecodeJob *job = (struct DecodeJob *)context;
+	npy_intp row, first = index * job->rowsPerTask, rows = job->rowsPerTask;
+	float *rawDataPos = job->rawData + first * job->numOfColumns;
+	int j;
+	if(first + rows > job->rows) rows = job->rows - first;
+
+	// Vector by vector, the rows of one range stay in cache.
+	for(j = 0; j < job->numOfVectors; j++)
+	{
+		struct FastArray *faPos = &job->faPtr[j];
+		char *pos = faPos->data + first * faPos->stride;
+		float *src = rawDataPos;
+		if(job->type == complex_var && j > 0 && j < job->numOfVariables)
+		{
+			for(row = 0; row < rows; row++)
+			{
+				((npy_cdouble *)pos)->real = src[0];
+				((npy_cdouble *)pos)->imag = src[1];
+				pos = pos + faPos->stride;
+				src = src + job->numOfColumns;
+			}
+			rawDataPos = rawDataPos + 2;
+		}
+		else
+		{
+			for(row = 0; row < rows; row++)
+			{
+				*((npy_double *)pos) = *src;
+				pos = pos + faPos->stride;
+				src = src + job->numOfColumns;
+			}
+			rawDataPos = rawDataPos + 1;
+		}
+	}
+}
+
+// Read one table for one sweep value. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   f              ... pointer to file for reading
+//   debugMode      ... debug messages flag
+//   fileName       ... name of the file
+//   sweep          ... sweep parameter name
+//   numOfVariables ... number of variables in table
+//   type           ... type of variables with exeption of scale 
+//   numOfVectors   ... number of variables and probes in table
+//   faSweep        ... pointer to fast access structure for sweep array
+//   buffers        ... scratch space with room for numOfVectors arrays
+//   numOfThreads   ... number of threads for decoding, 0 or less for one
+//                      thread per processor
+//   keys           ... tuple of vector names, scale first
+//   dataList       ... list of data dictionaries
+int readTable(FILE *f, int debugMode, const char *fileName, PyObject *sweep,
+			  int numOfVariables, int type, int numOfVectors,
+			  struct FastArray *faSweep, struct ReadBuffers *buffers,
+			  int numOfThreads, PyObject *keys, PyObject *dataList)
+{
+	int i, j, num, numOfTasks, numOfColumns = numOfVectors;
+    size_t offset = 0;
+	npy_intp dims, rows;
+	float *rawDataPos;
+	PyObject *data = NULL, **tmpArray = buffers->tmpArray;
+	struct FastArray *faPtr = buffers->faPtr;
+	struct DecodeJob job;
+
+	// Read raw data blocks.
+	num = readRawTable(f, debugMode, fileName, buffers, &offset);
+	if(num) goto readTableFailed;
+
+	data = PyDict_New();	// Create an empty dictionary.
+	if(data == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: failed to create data dictionary.\n");
+		goto readTableFailed;
+	}
+
+	// Increase number of columns if variables with exeption of scale are complex.
+	if(type == complex_var) numOfColumns = numOfColumns + numOfVariables - 1;
+
+	rawDataPos = buffers->rawData;
+	if(sweep == NULL) rows = (offset - 1) / numOfColumns;	// Number of rows.
+	else
+	{
+		rows = (offset - 2) / numOfColumns;
+		*((npy_double *)(faSweep->pos)) = *rawDataPos;	// Save sweep value.
+		rawDataPos = rawDataPos + 1;
+		faSweep->pos = faSweep->pos + faSweep->stride;
+	}
+
+	for(i = 0; i < numOfVectors; i++)
+	{
+		// Create array for i-th vector.
+		dims=rows;
+		if(type == complex_var && i > 0 && i < numOfVariables)
+			tmpArray[i] = PyArray_SimpleNew(1, &dims, PyArray_CDOUBLE);
+		else
+			tmpArray[i] = PyArray_SimpleNew(1, &dims, PyArray_DOUBLE);
+		if(tmpArray[i] == NULL)
+		{
+			if(debugMode)
+				fprintf(debugFile, "HSpiceRead: failed to create array.\n");
+			for(j = 0; j < i + 1; j++) Py_XDECREF(tmpArray[j]);
+			goto readTableFailed;
+		}
+	}
+
+	for(i = 0; i < numOfVectors; i++)	// Prepare fast access structures.
+	{
+		faPtr[i].data = ((PyArrayObject *)(tmpArray[i]))->data;
+		faPtr[i].pos = ((PyArrayObject *)(tmpArray[i]))->data;
+		faPtr[i].stride =
+			((PyArrayObject *)(tmpArray[i]))->strides[((PyArrayObject *)(tmpArray[i]))->nd -
+			1];
+		faPtr[i].length = PyArray_Size(tmpArray[i]);
+	}
+
+	// Save raw data. Rows have a fixed width so the table is split into row
+	// ranges that are decoded independently. Small tables are decoded by the
+	// calling thread alone. Large tables are decoded without the GIL. The
+	// workers do not use the Python API, the arrays are not visible to Python
+	// code yet and a Reader object refuses other calls while it is reading.
+	job.rawData = rawDataPos;
+	job.faPtr = faPtr;
+	job.numOfVectors = numOfVectors;
+	job.numOfVariables = numOfVariables;
+	job.type = type;
+	job.numOfColumns = numOfColumns;
+	job.rows = rows;
+	job.rowsPerTask = decodeRangeSize / numOfColumns + 1;
+	numOfTasks = (int)((rows + job.rowsPerTask - 1) / job.rowsPerTask);
+	if(rows * numOfColumns < parallelDecodeSize)
+		runParallel(1, numOfTasks, decodeRows, &job);
+	else
+	{
+		numOfThreads = getNumOfThreads(numOfThreads, numOfTasks);
+		Py_BEGIN_ALLOW_THREADS
+		runParallel(numOfThreads, numOfTasks, decodeRows, &job);
+		Py_END_ALLOW_THREADS
+	}
+
+	// Insert vectors into dictionary.
+	num = 0;
+	for(i = 0; i < numOfVectors; i++)
+	{
+		num = PyDict_SetItem(data, PyTuple_GET_ITEM(keys, i), tmpArray[i]);
+		if(num != 0) break;
+	}
+	for(j = 0; j < numOfVectors; j++) Py_XDECREF(tmpArray[j]);
+	if(num)
+	{
+	  if(debugMode)
+	    fprintf(debugFile, "HSpiceRead: failed to insert vector %s into dictionary.\n",
+	            PyUnicode_AsUTF8(PyTuple_GET_ITEM(keys, i)));
+	  goto readTableFailed;
+	}
+
+	// Insert table into the list of data dictionaries.
+	num = PyList_Append(dataList, data);
+	if(num)
+	{
+		if(debugMode) fprintf(debugFile,
+							  "HSpiceRead: failed to append table to the list of data dictionaries.\n");
+		goto readTableFailed;
+	}
+	Py_XDECREF(data);
+	data = NULL;
+
+	return 0;
+
+readTableFailed:
+	Py_XDECREF(data);
+	return 1;
+}
+
+// Read only the tables chosen by a selection callable. All tables are first
+// scanned for their positions and sweep values, then the callable is invoked
+// with the array of sweep values. It must return a sequence of table indices.
+// Only the selected tables are decoded. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   f              ... pointer to file for reading
+//   debugMode      ... debug messages flag
+//   fileName       ... name of the file
+//   select         ... selection callable
+//   sweep          ... sweep parameter name
+//   sweepSize      ... number of tables in the file
+//   sweepValues    ... sweep points array, replaced with the array of selected
+//                      sweep points
+//   faSweep        ... pointer to fast access structure for sweep array
+//   numOfVariables ... number of variables in table
+//   type           ... type of variables with exeption of scale
+//   numOfVectors   ... number of variables and probes in table
+//   buffers        ... scratch space with room for numOfVectors arrays
+//   numOfThreads   ... number of threads for decoding, 0 or less for one
+//                      thread per processor
+//   keys           ... tuple of vector names, scale first
+//   dataList       ... list of data dictionaries
+int readSelectedTables(FILE *f, int debugMode, const char *fileName,
+					   PyObject *select, PyObject *sweep, int sweepSize,
+					   PyObject **sweepValues, struct FastArray *faSweep,
+					   int numOfVariables, int type, int numOfVectors,
+					   struct ReadBuffers *buffers, int numOfThreads,
+					   PyObject *keys, PyObject *dataList)
+{
+	int i, num;
+	FileOffset *tableOffset = NULL;
+	npy_intp dims;
+	PyObject *indices = NULL, *seq = NULL, *selectedValues = NULL;
+
+	// Allocate space for table positions.
+	tableOffset = (FileOffset *)PyMem_Malloc(sweepSize * sizeof(FileOffset));
+	if(tableOffset == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: cannot allocate table positions.\n");
+		goto readSelectedTablesFailed;
+	}
+
+	// Collect table positions and sweep values.
+	num = scanTables(f, debugMode, fileName, sweepSize, tableOffset, NULL,
+					 faSweep);
+	if(num) goto readSelectedTablesFailed;
+
+	// Ask for the indices of the tables to read.
+	indices = PyObject_CallFunctionObjArgs(select, *sweepValues, NULL);
+	if(indices == NULL)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: sweep selection failed.\n");
+		goto readSelectedTablesFailed;
+	}
+	seq = PySequence_Fast(indices, "sweep selection must return a sequence");
+	if(seq == NULL)
+	{
+		if(debugMode) fprintf(debugFile,
+							  "HSpiceRead: sweep selection is not a sequence.\n");
+		goto readSelectedTablesFailed;
+	}
+
+	// Create array for selected sweep parameter values.
+	dims = PySequence_Fast_GET_SIZE(seq);
+	selectedValues = PyArray_SimpleNew(1, &dims, PyArray_DOUBLE);
+	if(selectedValues == NULL)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: failed to create array.\n");
+		goto readSelectedTablesFailed;
+	}
+	faSweep->data = ((PyArrayObject *)selectedValues)->data;
+	faSweep->pos = ((PyArrayObject *)selectedValues)->data;
+	faSweep->stride =
+		((PyArrayObject *)selectedValues)->strides[((PyArrayObject *)selectedValues)->nd -
+		1];
+	faSweep->length = PyArray_Size(selectedValues);
+
+	for(i = 0; i < dims; i++)	// Read selected tables.
+	{
+		long index = PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i));
+		if(index < 0 || index >= sweepSize)
+		{
+			if(debugMode) fprintf(debugFile,
+								  "HSpiceRead: sweep index out of range.\n");
+			if(!PyErr_Occurred())
+				PyErr_SetString(PyExc_IndexError, "sweep index out of range");
+			goto readSelectedTablesFailed;
+		}
+		if(fileSeek(f, tableOffset[index], SEEK_SET) != 0)
+		{
+			if(debugMode) fprintf(debugFile,
+								  "HSpiceRead: failed to seek in file %s.\n",
+								  fileName);
+			goto readSelectedTablesFailed;
+		}
+		num = readTable(f, debugMode, fileName, sweep, numOfVariables, type,
+						numOfVectors, faSweep, buffers, numOfThreads, keys,
+						dataList);
+		if(num) goto readSelectedTablesFailed;
+	}
+
+	PyMem_Free(tableOffset);
+	Py_XDECREF(indices);
+	Py_XDECREF(seq);
+	Py_XDECREF(*sweepValues);
+	*sweepValues = selectedValues;
+	return 0;
+
+readSelectedTablesFailed:
+	PyMem_Free(tableOffset);
+	Py_XDECREF(indices);
+	Py_XDECREF(seq);
+	Py_XDECREF(selectedValues);
+	return 1;
+}
+
+// Get number of threads to use. Returns at least 1 and at most numOfTasks.
+// Arguments:
+//   requested  ... requested number of threads, 0 or less for one thread per
+//                  processor
+//   numOfTasks ... number of tasks to run
+int getNumOfThreads(int requested, int numOfTasks)
+{
+	int num = requested;
+	if(num <= 0)
+	{
+#ifdef LINUX
+		num = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+		num = 1;
+#endif
+	}
+	if(num > numOfTasks) num = numOfTasks;
+	if(num < 1) num = 1;
+	return num;
+}
+
+// Thread body, takes tasks from the job until there are none left. Argument:
+//   arg ... pointer to ParallelJob structure
+void *parallelWorker(void *arg)
+{
+	struct ParallelJob *job = (struct ParallelJob *)arg;
+	for(;;)
+	{
+		int index;
+#ifdef LINUX
+		pthread_mutex_lock(&job->lock);
+#endif
+		index = job->next;
+		job->next = job->next + 1;
+#ifdef LINUX
+		pthread_mutex_unlock(&job->lock);
+#endif
+		if(index >= job->numOfTasks) break;
+		job->task(job->context, index);
+	}
+	return NULL;
+}
+
+// Run numOfTasks tasks on numOfThreads threads. The calling thread takes part
+// in the work. Tasks must not use the Python API. Arguments:
+//   numOfThreads ... number of threads
+//   numOfTasks   ... number of tasks
+//   task         ... task function, called with context and task index
+//   context      ... pointer passed to task function
+void runParallel(int numOfThreads, int numOfTasks,
+				 void (*task)(void *context, int index), void *context)
+{
+	struct ParallelJob job;
+	job.task = task;
+	job.context = context;
+	job.numOfTasks = numOfTasks;
+	job.next = 0;
+#ifdef LINUX
+	pthread_mutex_init(&job.lock, NULL);	// Workers lock it even if alone.
+	if(numOfThreads > 1)
+	{
+		int i, started = 0;
+		pthread_t *threads =
+			(pthread_t *)PyMem_RawMalloc((numOfThreads - 1) * sizeof(pthread_t));
+		// If a thread cannot be created the remaining ones do its work.
+		if(threads != NULL) for(i = 0; i < numOfThreads - 1; i++)
+		{
+			if(pthread_create(&threads[started], NULL, parallelWorker, &job) != 0)
+				break;
+			started++;
+		}
+		parallelWorker(&job);
+		for(i = 0; i < started; i++) pthread_join(threads[i], NULL);
+		pthread_mutex_destroy(&job.lock);
+		PyMem_RawFree(threads);
+		return;
+	}
+#endif
+	parallelWorker(&job);
+#ifdef LINUX
+	pthread_mutex_destroy(&job.lock);
+#endif
+}
+
+// Prepare a stream for reading one table value by value. Only one data block
+// is held in memory. Arguments:
+//   s         ... stream structure
+//   f         ... pointer to file for reading, positioned at table start
+//   debugMode ... debug messages flag
+//   fileName  ... name of the file
+void streamInit(struct TableStream *s, FILE *f, int debugMode,
+				const char *fileName)
+{
+	s->f = f;
+	s->debugMode = debugMode;
+	s->fileName = fileName;
+	s->buf = NULL;
+	s->size = 0;
+	s->count = 0;
+	s->pos = 0;
+	s->last = 0;
+}
+
+// Release memory held by a stream. Argument:
+//   s ... stream structure
+void streamFree(struct TableStream *s)
+{
+	PyMem_RawFree(s->buf);
+	s->buf = NULL;
+	s->size = 0;
+}
+
+// Read next value from table stream. Returns:
+//   -1 ... end of table reached
+//    0 ... value read
+//    1 ... error occured
+// Arguments:
+//   s     ... stream structure
+//   value ... pointer to space for the value
+int streamNextValue(struct TableStream *s, float *value)
+{
+	while(s->pos >= s->count)	// Load next block.
+	{
+		int error, blockHeader[blockHeaderSize], swap;
+		size_t dummy = 0;
+		if(s->last) return -1;	// End of table already reached.
+
+		swap = readBlockHeader(s->f, s->fileName, s->debugMode, blockHeader,
+							   sizeof(float));
+		if(swap < 0) return 1;	// Error.
+		if((size_t)blockHeader[0] > s->size)
+		{
+			float *tmp = (float *)PyMem_RawRealloc(s->buf,
+												   blockHeader[0] * sizeof(float));
+			if(tmp == NULL)
+			{
+				if(s->debugMode) fprintf(debugFile, "HSpiceRead: cannot allocate.\n");
+				return 1;	// Error.
+			}
+			s->buf = tmp;
+			s->size = blockHeader[0];
+		}
+		error = readBlockData(s->f, s->fileName, s->debugMode, s->buf, &dummy,
+							  sizeof(float), blockHeader[0], swap);
+		if(error == 1) return 1;	// Error.
+		error = readBlockTrailer(s->f, s->fileName, s->debugMode, swap,
+								 blockHeader[blockHeaderSize - 1]);
+		if(error == 1) return 1;	// Error.
+		s->count = blockHeader[0];
+		s->pos = 0;
+		s->last = s->count > 0 && s->buf[s->count - 1] > 9e29;
+	}
+
+	if(s->last && s->pos == s->count - 1)	// End of table marker.
+	{
+		s->pos = s->count;
+		return -1;
+	}
+	*value = s->buf[s->pos];
+	s->pos = s->pos + 1;
+	return 0;
+}
+
+// Read one row of a table from table stream. Returns:
+//   -1 ... end of table reached
+//    0 ... row read
+//    1 ... error occured
+// Arguments:
+//   s            ... stream structure
+//   row          ... space for numOfColumns values
+//   numOfColumns ... number of values in a row
+int streamReadRow(struct TableStream *s, float *row, int numOfColumns)
+{
+	int i, num;
+	for(i = 0; i < numOfColumns; i++)
+	{
+		num = streamNextValue(s, &row[i]);
+		if(num == -1 && i == 0) return -1;	// End of table.
+		if(num != 0)
+		{
+			if(num == -1 && s->debugMode)
+				fprintf(debugFile, "HSpiceRead: incomplete row in file %s.\n",
+						s->fileName);
+			return 1;	// Error.
+		}
+	}
+	return 0;
+}
+
+// Get number of numbers in one table row. Argument:
+//   header ... parsed file header
+int getNumOfColumns(struct FileHeader *header)
+{
+	if(header->type == complex_var)
+		return header->numOfVectors + header->numOfVariables - 1;
+	return header->numOfVectors;
+}
+
+// Get position of a vector within a table row. Arguments:
+//   header ... parsed file header
+//   vector ... vector index, 0 is the scale
+int getVectorColumn(struct FileHeader *header, int vector)
+{
+	if(header->type != complex_var || vector == 0) return vector;
+	if(vector < header->numOfVariables) return 2 * vector - 1;
+	return vector + header->numOfVariables - 1;
+}
+
+// Check if a vector is complex. Arguments:
+//   header ... parsed file header
+//   vector ... vector index, 0 is the scale
+int isComplexVector(struct FileHeader *header, int vector)
+{
+	return header->type == complex_var && vector > 0 &&
+		vector < header->numOfVariables;
+}
+
+// Find vector by name. Returns vector index (0 is the scale) or -1 if there is
+// no such vector. Arguments:
+//   header ... parsed file header
+//   name   ... vector name
+int findVector(struct FileHeader *header, const char *name)
+{
+	int i;
+	if(strcmp(header->scale, name) == 0) return 0;
+	for(i = 0; i < header->numOfVectors - 1; i++)
+		if(strcmp(header->name[i], name) == 0) return i + 1;
+	return -1;
+}
+
+// Open a file and position it at the start of a table. Returns:
+//   NULL    ... failed
+//   pointer ... opened file
+// Arguments:
+//   debugMode ... debug messages flag
+//   fileName  ... name of the file
+//   offset    ... table position
+FILE *openTable(int debugMode, const char *fileName, FileOffset offset)
+{
+	FILE *f = fopen(fileName, "rb");
+	if(f == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: cannot open file %s.\n", fileName);
+		return NULL;
+	}
+	if(fileSeek(f, offset, SEEK_SET) != 0)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: failed to seek in file %s.\n", fileName);
+		fclose(f);
+		return NULL;
+	}
+	return f;
+}
+
+// Open one table for reading rows interpolated to increasing scale points.
+// Only two rows of the table are held in memory. Returns:
+//   0 ... performed normally
+//   1 ... error occurred, followerFree() must still be called
+// Arguments:
+//   fl           ... follower structure
+//   debugMode    ... debug messages flag
+//   fileName     ... name of the file
+//   offset       ... table position
+//   numOfColumns ... number of values in a row
+//   sweepValue   ... pointer to space for sweep value, NULL if not swept
+int followerInit(struct ScaleFollower *fl, int debugMode, const char *fileName,
+				 FileOffset offset, int numOfColumns, float *sweepValue)
+{
+	int num;
+	fl->f = openTable(debugMode, fileName, offset);
+	streamInit(&fl->s, fl->f, debugMode, fileName);
+	fl->numOfColumns = numOfColumns;
+	fl->haveCur = 0;
+	fl->rows = 0;
+	fl->prev = (float *)PyMem_RawMalloc(numOfColumns * sizeof(float));
+	fl->cur = (float *)PyMem_RawMalloc(numOfColumns * sizeof(float));
+	if(fl->f == NULL) return 1;
+	if(fl->prev == NULL || fl->cur == NULL)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: cannot allocate.\n");
+		return 1;
+	}
+
+	// Sweep value comes first.
+	if(sweepValue != NULL && streamNextValue(&fl->s, sweepValue) != 0) return 1;
+
+	// Prime with the first two rows.
+	if(streamReadRow(&fl->s, fl->prev, numOfColumns) != 0)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: empty table in file %s.\n", fileName);
+		return 1;
+	}
+	num = streamReadRow(&fl->s, fl->cur, numOfColumns);
+	if(num > 0) return 1;
+	fl->haveCur = num == 0;
+	fl->rows = fl->haveCur ? 2 : 1;
+	return 0;
+}
+
+// Release a follower. Argument:
+//   fl ... follower structure
+void followerFree(struct ScaleFollower *fl)
+{
+	streamFree(&fl->s);
+	if(fl->f) fclose(fl->f);
+	fl->f = NULL;
+	PyMem_RawFree(fl->prev);
+	PyMem_RawFree(fl->cur);
+	fl->prev = fl->cur = NULL;
+}
+
+// Advance a follower to scale point t. The value of column c at t is
+// lo[c] + w * (hi[c] - lo[c]). Values are clamped outside of the table scale.
+// Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   fl ... follower structure
+//   t  ... scale point, not smaller than at the previous call
+//   lo ... acquired row before t
+//   hi ... acquired row after t
+//   w  ... acquired interpolation weight
+int followerSeek(struct ScaleFollower *fl, double t, float **lo, float **hi,
+				 double *w)
+{
+	int num;
+	float *tmp;
+
+	// Advance until the current row is not before t.
+	while(fl->haveCur && fl->cur[0] < t)
+	{
+		tmp = fl->prev;
+		fl->prev = fl->cur;
+		fl->cur = tmp;
+		num = streamReadRow(&fl->s, fl->cur, fl->numOfColumns);
+		if(num > 0) return 1;
+		fl->haveCur = num == 0;
+		if(fl->haveCur) fl->rows = fl->rows + 1;
+	}
+
+	// Interpolate between the rows around t, clamp outside of the scale.
+	*lo = *hi = fl->prev;
+	*w = 0.0;
+	if(fl->haveCur && fl->cur[0] == t) *lo = *hi = fl->cur;
+	else if(fl->haveCur && fl->prev[0] < t)
+	{
+		*hi = fl->cur;
+		*w = (t - fl->prev[0]) / ((double)fl->cur[0] - fl->prev[0]);
+	}
+	return 0;
+}
+
+// Read the rest of the table of a follower. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   fl   ... follower structure
+//   last ... acquired scale value of the last row
+int followerDrain(struct ScaleFollower *fl, double *last)
+{
+	int num;
+	float *tmp;
+	while(fl->haveCur)
+	{
+		tmp = fl->prev;
+		fl->prev = fl->cur;
+		fl->cur = tmp;
+		num = streamReadRow(&fl->s, fl->cur, fl->numOfColumns);
+		if(num > 0) return 1;
+		fl->haveCur = num == 0;
+		if(fl->haveCur) fl->rows = fl->rows + 1;
+	}
+	*last = fl->prev[0];
+	return 0;
+}
+
+// Interpolate linearly between lo and hi. Returns lo at w = 0 so that an
+// infinite value is not turned into NaN. Arguments:
+//   lo ... value at w = 0
+//   hi ... value at w = 1
+//   w  ... interpolation weight
+double lerp(double lo, double hi, double w)
+{
+	if(w == 0.0) return lo;
+	return lo + w * (hi - lo);
+}
+
+// Compare one table of two files. Rows of the second file are linearly
+// interpolated to the scale points of the first file so only the current row
+// of the first file and two rows of the second file are held in memory.
+// Results are stored in the job structure, together with the sweep value,
+// scale range and row count of both tables so that tables which do not
+// correspond can be reported. Arguments:
+//   context ... pointer to CompareJob structure
+//   index   ... table index
+void compareTable(void *context, int index)
+{
+	struct CompareJob *job = (struct CompareJob *)context;
+	struct TableStream sa;
+	struct ScaleFollower fb;
+	FILE *fa = NULL;
+	float *rowA = NULL, value, valueB;
+	int i, num, columnsA = getNumOfColumns(job->headerA);
+	double *maxError = job->maxError + (size_t)index * job->numOfSignals;
+	double *firstFailure = job->firstFailure + (size_t)index * job->numOfSignals;
+	int *failed = job->failed + (size_t)index * job->numOfSignals;
+	double *scaleRange = job->scaleRange + 4 * (size_t)index;
+	npy_intp *rows = job->rows + 2 * (size_t)index;
+
+	job->error[index] = 1;
+	scaleRange[0] = scaleRange[1] = NAN;
+	rows[0] = 0;
+	for(i = 0; i < job->numOfSignals; i++)
+	{
+		maxError[i] = 0.0;
+		firstFailure[i] = 0.0;
+		failed[i] = 0;
+	}
+
+	fa = openTable(job->debugMode, job->fileNameA, job->offsetA[index]);
+	streamInit(&sa, fa, job->debugMode, job->fileNameA);
+	num = followerInit(&fb, job->debugMode, job->fileNameB, job->offsetB[index],
+					   getNumOfColumns(job->headerB),
+					   job->headerB->sweep != NULL ? &valueB : NULL);
+	if(fa == NULL || num) goto compareTableFailed;
+	if(job->headerB->sweep != NULL) job->sweepValueB[index] = valueB;
+	scaleRange[2] = fb.prev[0];
+
+	rowA = (float *)PyMem_RawMalloc(columnsA * sizeof(float));
+	if(rowA == NULL)
+	{
+		if(job->debugMode) fprintf(debugFile, "HSpiceRead: cannot allocate.\n");
+		goto compareTableFailed;
+	}
+
+	if(job->headerA->sweep != NULL)	// Sweep value comes first.
+	{
+		if(streamNextValue(&sa, &value) != 0) goto compareTableFailed;
+		job->sweepValue[index] = value;
+	}
+
+	while((num = streamReadRow(&sa, rowA, columnsA)) == 0)
+	{
+		double t = rowA[0], w;
+		float *lo, *hi;
+
+		if(rows[0] == 0) scaleRange[0] = t;
+		scaleRange[1] = t;
+		rows[0] = rows[0] + 1;
+		if(followerSeek(&fb, t, &lo, &hi, &w)) goto compareTableFailed;
+
+		for(i = 0; i < job->numOfSignals; i++)
+		{
+			int ca = job->columnA[i], cb = job->columnB[i];
+			double re = rowA[ca], im = 0.0, error, tolerance;
+			double dre = re - lerp(lo[cb], hi[cb], w), dim = 0.0;
+			if(job->isComplex[i])
+			{
+				im = rowA[ca + 1];
+				dim = im - lerp(lo[cb + 1], hi[cb + 1], w);
+			}
+			error = hypot(dre, dim);
+			if(isnan(t)) error = t;	// Values at an invalid scale point.
+			tolerance = job->atol + job->rtol * hypot(re, im);
+
+			// NaN never passes and stays the maximal error once seen.
+			if(!(error <= maxError[i]) && !isnan(maxError[i])) maxError[i] = error;
+			if(!(error <= tolerance) && !failed[i])
+			{
+				failed[i] = 1;
+				firstFailure[i] = t;
+			}
+		}
+	}
+	if(num > 0) goto compareTableFailed;
+
+	// Rows of the second file past the end of the first one.
+	if(followerDrain(&fb, &scaleRange[3])) goto compareTableFailed;
+	rows[1] = fb.rows;
+
+	job->error[index] = 0;
+
+compareTableFailed:
+	if(job->error[index] && job->debugMode)
+		fprintf(debugFile, "HSpiceRead: failed to compare table %d.\n", index);
+	streamFree(&sa);
+	if(fa) fclose(fa);
+	followerFree(&fb);
+	PyMem_RawFree(rowA);
+}
+
+// Describe how two compared tables do not correspond. Sweep values must
+// match within rtol. Scale ranges must match within rtol of the scale span,
+// otherwise the second table is shorter or longer than the first one and its
+// values would be held flat past its end. Returns:
+//   0 ... tables correspond
+//   1 ... tables do not correspond, description stored in text
+// Arguments:
+//   job   ... comparison job after all tables were compared
+//   index ... table index
+//   text  ... space for description
+//   size  ... size of text
+int describeMismatch(struct CompareJob *job, int index, char *text, size_t size)
+{
+	double *scaleRange = job->scaleRange + 4 * (size_t)index;
+	double tolerance = job->rtol * fabs(scaleRange[1] - scaleRange[0]);
+	npy_intp *rows = job->rows + 2 * (size_t)index;
+	size_t length = 0;
+
+	text[0] = 0;
+	if(job->headerA->sweep != NULL)
+	{
+		double sweepA = job->sweepValue[index], sweepB = job->sweepValueB[index];
+		if(!(fabs(sweepB - sweepA) <= job->rtol * fabs(sweepA)))
+			length = snprintf(text, size, "sweep value %g differs from %g",
+							  sweepB, sweepA);
+	}
+	if(length < size && (!(fabs(scaleRange[2] - scaleRange[0]) <= tolerance) ||
+						 !(fabs(scaleRange[3] - scaleRange[1]) <= tolerance)))
+		snprintf(text + length, size - length,
+				 "%sscale range [%g, %g] with %ld rows differs from "
+				 "[%g, %g] with %ld rows", length > 0 ? "; " : "",
+				 scaleRange[2], scaleRange[3], (long)rows[1], scaleRange[0],
+				 scaleRange[1], (long)rows[0]);
+	return text[0] != 0;
+}
+
+// Read a HSpice output file using scratch space and header layout cache.
+// Returns:
+//   NULL    ... error occurred
+//   pointer ... list with read data, new reference created
+// Arguments:
+//   buffers      ... scratch space, kept for further reads
+//   cache        ... header layout cache, kept for further reads
+//   fileName     ... name of the file
+//   debugMode    ... debug messages flag
+//   select       ... sweep selection callable, Py_None for all sweeps
+//   numOfThreads ... number of threads for decoding large tables, 0 or less
+//                    for one thread per processor
+PyObject *readFile(struct ReadBuffers *buffers, struct HeaderCache *cache,
+				   const char *fileName, int debugMode, PyObject *select,
+				   int numOfThreads)
+{
+	int num, i;
+	struct FastArray faSweep;
+	struct FileHeader header;
+	FILE *f = NULL;
+	PyObject *date = NULL, *title = NULL, *scale = NULL, *sweep = NULL,
+		*sweepValues = NULL, *dataList = NULL, *sweeps = NULL, *tuple = NULL,
+		*list = NULL;
+
+	if(debugMode) fprintf(debugFile, "HSpiceRead: reading file %s.\n", fileName);
+
+	f = fopen(fileName, "rb");	// Open the file.
+	if(f == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: cannot open file %s.\n", fileName);
+		goto failed;
+	}
+
+	// Parse file header.
+	num = readPooledHeader(f, debugMode, fileName, buffers, cache, &header);
+	if(num) goto failed;
+	num = getHeaderKeys(debugMode, cache);
+	if(num) goto failed;
+
+	date = PyUnicode_FromString(header.date);	// Get creation date.
+	if(date == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: failed to create date string.\n");
+		goto failed;
+	}
+
+	title = PyUnicode_FromString(header.title);	// Get title.
+	if(title == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: failed to create title string.\n");
+		goto failed;
+	}
+
+	scale = PyTuple_GET_ITEM(cache->keys, 0);	// Get independent variable name.
+	Py_INCREF(scale);
+
+	if(header.numOfSweeps == 1)	// Get sweep information.
+	{
+		num = getSweepInfo(debugMode, &sweep, &header, &sweepValues, &faSweep);
+		if(num) goto failed;
+	}
+
+	dataList = PyList_New(0);	// Create an empty list for data dictionaries.
+	if(dataList == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: failed to create data list.\n");
+		goto failed;
+	}
+
+	// Make room for pointers to arrays and fast array pointers.
+	num = reserveVectors(debugMode, buffers, header.numOfVectors);
+	if(num) goto failed;
+
+	if(sweep != NULL && select != Py_None)	// Read selected tables only.
+	{
+		num = readSelectedTables(f, debugMode, fileName, select, sweep,
+								 header.sweepSize, &sweepValues, &faSweep,
+								 header.numOfVariables, header.type,
+								 header.numOfVectors, buffers, numOfThreads,
+								 cache->keys, dataList);
+		if(num) goto failed;
+	}
+	else for(i = 0; i < header.sweepSize; i++)	// Read i-th table.
+	{
+		num = readTable(f, debugMode, fileName, sweep, header.numOfVariables,
+						header.type, header.numOfVectors, &faSweep, buffers,
+						numOfThreads, cache->keys, dataList);
+		if(num) goto failed;
+	}
+	fclose(f);
+	f = NULL;
+
+	// Create sweeps tuple.
+	if(sweep == NULL) sweeps = PyTuple_Pack(3, Py_None, Py_None, dataList);
+	else sweeps = PyTuple_Pack(3, sweep, sweepValues, dataList);
+	if(sweeps == NULL)
+	{
+		if(debugMode) fprintf(debugFile,
+							  "HSpiceRead: failed to create tuple with sweeps.\n");
+		goto failed;
+	}
+	Py_XDECREF(sweep);
+	sweep = NULL;
+	Py_XDECREF(sweepValues);
+	sweepValues = NULL;
+	Py_XDECREF(dataList);
+	dataList = NULL;
+
+	// Prepare return tuple.
+	tuple = PyTuple_Pack(6, sweeps, scale, Py_None, title, date, Py_None);
+	if(tuple == NULL)
+	{
+		if(debugMode) fprintf(debugFile,
+							  "HSpiceRead: failed to create tuple with read data.\n");
+		goto failed;
+	}
+	Py_XDECREF(date);
+	date = NULL;
+	Py_XDECREF(title);
+	title = NULL;
+	Py_XDECREF(scale);
+	scale = NULL;
+	Py_XDECREF(sweeps);
+	sweeps = NULL;
+
+	list = PyList_New(0);	// Create an empty list.
+	if(list == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: failed to create return list.\n");
+		goto failed;
+	}
+
+	num = PyList_Append(list, tuple);	// Insert tuple into return list.
 	if(num)
 	{
 		if(debugMode) fprintf(debugFile,
-							  "HSpiceRead: failed to append table to the list of data dictionaries.\n");
-		goto readTableFailed;
+							  "HSpiceRead: failed to append tuple to return list.\n");
+		goto failed;
 	}
-	Py_XDECREF(data);
-	data = NULL;
+	Py_XDECREF(tuple);
 
-	return 0;
+	return list;
 
-readTableFailed:
-	PyMem_Free(rawData);
-	Py_XDECREF(data);
-	return 1;
+failed:	// Error occured. Close open file and relese python references.
+	if (f)
+		fclose(f);
+	Py_XDECREF(date);
+	Py_XDECREF(title);
+	Py_XDECREF(scale);
+	Py_XDECREF(sweep);
+	Py_XDECREF(sweepValues);
+	Py_XDECREF(dataList);
+	Py_XDECREF(sweeps);
+	Py_XDECREF(tuple);
+	Py_XDECREF(list);
+	return NULL;
 }
 
 // This is the first prototype version of HSpiceRead function for reading HSpice
@@ -529,266 +1933,1469 @@ readTableFailed:
 static PyObject *HSpiceRead(PyObject *self, PyObject *args)
 {
 	const char *fileName;
-	char *token, *buf = NULL, **name = NULL;
-	int debugMode, num, numOfVectors, numOfVariables, type, sweepSize = 1,
-		i = dateStartPosition - 1;
-    size_t offset = 0;
-	struct FastArray faSweep, *faPtr = NULL;
-	FILE *f = NULL;
-	PyObject *date = NULL, *title = NULL, *scale = NULL, *sweep = NULL,
-		*sweepValues = NULL, *dataList = NULL, **tmpArray = NULL, *sweeps = NULL,
-		*tuple = NULL, *list = NULL;
+	int debugMode, numOfThreads = 0;
+	struct ReadBuffers buffers;
+	struct HeaderCache cache;
+	PyObject *list, *select = Py_None;
 
 	// Get hspice_read() arguments.
-	if(!PyArg_ParseTuple(args, "si", &fileName, &debugMode)) return Py_None;
+	if(!PyArg_ParseTuple(args, "si|Oi", &fileName, &debugMode, &select,
+						 &numOfThreads))
+		return NULL;
+
+	memset(&buffers, 0, sizeof(buffers));
+	memset(&cache, 0, sizeof(cache));
+	list = readFile(&buffers, &cache, fileName, debugMode, select, numOfThreads);
+	freeReadBuffers(&buffers);
+	freeHeaderCache(&cache);
+
+	if(list != NULL) return list;
+	if(PyErr_Occurred()) return NULL;	// Propagate Python exceptions.
+	Py_INCREF(Py_None);
+	return Py_None;
+}
 
-	if(debugMode) fprintf(debugFile, "HSpiceRead: reading file %s.\n", fileName);
+// Compare two HSpice output files table by table without loading them. Tables
+// are compared in parallel. Rows of the second file are interpolated to the
+// scale of the first file if the scales differ.
+static PyObject *HSpiceCompare(PyObject *self, PyObject *args)
+{
+	const char *fileNameA, *fileNameB, **signalName = NULL;
+	int debugMode, num, i, j, numOfThreads = 0, allPassed = 1;
+	FileOffset *offsetA = NULL, *offsetB = NULL;
+	double *scratch = NULL;
+	struct FastArray faScratch;
+	struct FileHeader headerA = {NULL, NULL}, headerB = {NULL, NULL};
+	struct CompareJob job;
+	FILE *fa = NULL, *fb = NULL;
+	PyObject *signals = Py_None, *seq = NULL, *tables = NULL, *sweepValues = NULL,
+		*errors = NULL, *item = NULL, *tuple = NULL;
+
+	memset(&job, 0, sizeof(job));
+
+	// Get hspice_compare() arguments.
+	if(!PyArg_ParseTuple(args, "ssddi|Oi", &fileNameA, &fileNameB, &job.rtol,
+						 &job.atol, &debugMode, &signals, &numOfThreads))
+		return NULL;
+
+	if(debugMode) fprintf(debugFile, "HSpiceRead: comparing files %s and %s.\n",
+						  fileNameA, fileNameB);
+
+	fa = fopen(fileNameA, "rb");	// Open the files and parse their headers.
+	if(fa == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: cannot open file %s.\n", fileNameA);
+		goto compareFailed;
+	}
+	if(readFileHeader(fa, debugMode, fileNameA, &headerA)) goto compareFailed;
+	fb = fopen(fileNameB, "rb");
+	if(fb == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: cannot open file %s.\n", fileNameB);
+		goto compareFailed;
+	}
+	if(readFileHeader(fb, debugMode, fileNameB, &headerB)) goto compareFailed;
 
-	f = fopen(fileName, "rb");	// Open the file.
+	if(headerA.numOfSweeps != headerB.numOfSweeps ||
+	   headerA.sweepSize != headerB.sweepSize)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: sweeps do not match.\n");
+		PyErr_SetString(PyExc_ValueError, "sweeps of compared files do not match");
+		goto compareFailed;
+	}
+
+	// Collect table positions of both files.
+	offsetA = (FileOffset *)PyMem_Malloc(headerA.sweepSize * sizeof(FileOffset));
+	offsetB = (FileOffset *)PyMem_Malloc(headerA.sweepSize * sizeof(FileOffset));
+	scratch = (double *)PyMem_Malloc(headerA.sweepSize * sizeof(double));
+	if(offsetA == NULL || offsetB == NULL || scratch == NULL)
+	{
+		if(debugMode)
+			fprintf(debugFile, "HSpiceRead: cannot allocate table positions.\n");
+		goto compareFailed;
+	}
+	faScratch.data = faScratch.pos = (char *)scratch;
+	faScratch.stride = sizeof(double);
+	faScratch.length = headerA.sweepSize;
+	if(scanTables(fa, debugMode, fileNameA, headerA.sweepSize, offsetA, NULL,
+				  &faScratch))
+		goto compareFailed;
+	faScratch.pos = faScratch.data;
+	if(scanTables(fb, debugMode, fileNameB, headerB.sweepSize, offsetB, NULL,
+				  &faScratch))
+		goto compareFailed;
+	fclose(fa);
+	fa = NULL;
+	fclose(fb);
+	fb = NULL;
+
+	// Get names of compared signals, all vectors of the first file by default.
+	if(signals == Py_None) job.numOfSignals = headerA.numOfVectors - 1;
+	else
+	{
+		seq = PySequence_Fast(signals, "signals must be a sequence of names");
+		if(seq == NULL) goto compareFailed;
+		job.numOfSignals = PySequence_Fast_GET_SIZE(seq);
+	}
+	signalName = (const char **)PyMem_Malloc((job.numOfSignals + 1) * sizeof(char *));
+	job.columnA = (int *)PyMem_Malloc((job.numOfSignals + 1) * sizeof(int));
+	job.columnB = (int *)PyMem_Malloc((job.numOfSignals + 1) * sizeof(int));
+	job.isComplex = (int *)PyMem_Malloc((job.numOfSignals + 1) * sizeof(int));
+	if(signalName == NULL || job.columnA == NULL || job.columnB == NULL ||
+	   job.isComplex == NULL)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: cannot allocate signals.\n");
+		goto compareFailed;
+	}
+	for(i = 0; i < job.numOfSignals; i++)
+	{
+		int vectorA, vectorB;
+		if(seq == NULL) signalName[i] = headerA.name[i];
+		else
+		{
+			signalName[i] = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq, i));
+			if(signalName[i] == NULL) goto compareFailed;
+		}
+		vectorA = findVector(&headerA, signalName[i]);
+		vectorB = findVector(&headerB, signalName[i]);
+		if(vectorA < 0 || vectorB < 0)
+		{
+			if(debugMode) fprintf(debugFile,
+								  "HSpiceRead: signal %s not found in both files.\n",
+								  signalName[i]);
+			PyErr_SetString(PyExc_KeyError, signalName[i]);
+			goto compareFailed;
+		}
+		job.isComplex[i] = isComplexVector(&headerA, vectorA);
+		if(job.isComplex[i] != isComplexVector(&headerB, vectorB))
+		{
+			if(debugMode) fprintf(debugFile,
+								  "HSpiceRead: signal %s type mismatch.\n",
+								  signalName[i]);
+			PyErr_SetString(PyExc_ValueError, "signal types do not match");
+			goto compareFailed;
+		}
+		job.columnA[i] = getVectorColumn(&headerA, vectorA);
+		job.columnB[i] = getVectorColumn(&headerB, vectorB);
+	}
+
+	// Allocate space for results.
+	job.fileNameA = fileNameA;
+	job.fileNameB = fileNameB;
+	job.debugMode = debugMode;
+	job.headerA = &headerA;
+	job.headerB = &headerB;
+	job.offsetA = offsetA;
+	job.offsetB = offsetB;
+	job.sweepValue = scratch;
+	job.maxError = (double *)PyMem_Malloc(
+		((size_t)headerA.sweepSize * job.numOfSignals + 1) * sizeof(double));
+	job.firstFailure = (double *)PyMem_Malloc(
+		((size_t)headerA.sweepSize * job.numOfSignals + 1) * sizeof(double));
+	job.failed = (int *)PyMem_Malloc(
+		((size_t)headerA.sweepSize * job.numOfSignals + 1) * sizeof(int));
+	job.error = (int *)PyMem_Malloc(headerA.sweepSize * sizeof(int));
+	job.sweepValueB = (double *)PyMem_Malloc(headerA.sweepSize * sizeof(double));
+	job.scaleRange = (double *)PyMem_Malloc(4 * headerA.sweepSize * sizeof(double));
+	job.rows = (npy_intp *)PyMem_Malloc(2 * headerA.sweepSize * sizeof(npy_intp));
+	if(job.maxError == NULL || job.firstFailure == NULL || job.failed == NULL ||
+	   job.error == NULL || job.sweepValueB == NULL || job.scaleRange == NULL ||
+	   job.rows == NULL)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: cannot allocate results.\n");
+		goto compareFailed;
+	}
+
+	// Compare tables.
+	numOfThreads = getNumOfThreads(numOfThreads, headerA.sweepSize);
+	Py_BEGIN_ALLOW_THREADS
+	runParallel(numOfThreads, headerA.sweepSize, compareTable, &job);
+	Py_END_ALLOW_THREADS
+	for(i = 0; i < headerA.sweepSize; i++) if(job.error[i]) goto compareFailed;
+
+	// Create sweep values array.
+	if(headerA.sweep != NULL)
+	{
+		npy_intp dims = headerA.sweepSize;
+		sweepValues = PyArray_SimpleNew(1, &dims, PyArray_DOUBLE);
+		if(sweepValues == NULL)
+		{
+			if(debugMode) fprintf(debugFile, "HSpiceRead: failed to create array.\n");
+			goto compareFailed;
+		}
+		memcpy(((PyArrayObject *)sweepValues)->data, scratch,
+			   headerA.sweepSize * sizeof(double));
+	}
+
+	tables = PyList_New(0);	// Create list of per-table results.
+	if(tables == NULL) goto compareFailed;
+	for(i = 0; i < headerA.sweepSize; i++)
+	{
+		char mismatch[256];
+		int passed = !describeMismatch(&job, i, mismatch, sizeof(mismatch));
+		errors = PyDict_New();
+		if(errors == NULL) goto compareFailed;
+		for(j = 0; j < job.numOfSignals; j++)
+		{
+			size_t k = (size_t)i * job.numOfSignals + j;
+			if(job.failed[k])
+			{
+				passed = 0;
+				item = Py_BuildValue("(dd)", job.maxError[k], job.firstFailure[k]);
+			}
+			else item = Py_BuildValue("(dO)", job.maxError[k], Py_None);
+			if(item == NULL) goto compareFailed;
+			num = PyDict_SetItemString(errors, signalName[j], item);
+			Py_XDECREF(item);
+			item = NULL;
+			if(num) goto compareFailed;
+		}
+		if(!passed) allPassed = 0;
+		if(mismatch[0] == 0)
+			item = Py_BuildValue("(OOO)", passed ? Py_True : Py_False, errors,
+								 Py_None);
+		else item = Py_BuildValue("(OOs)", Py_False, errors, mismatch);
+		if(item == NULL) goto compareFailed;
+		Py_XDECREF(errors);
+		errors = NULL;
+		num = PyList_Append(tables, item);
+		Py_XDECREF(item);
+		item = NULL;
+		if(num) goto compareFailed;
+	}
+
+	tuple = Py_BuildValue("(OOO)", allPassed ? Py_True : Py_False,
+						  sweepValues == NULL ? Py_None : sweepValues, tables);
+
+compareFailed:	// Also reached on success, tuple is NULL on failure.
+	if(fa) fclose(fa);
+	if(fb) fclose(fb);
+	freeFileHeader(&headerA);
+	freeFileHeader(&headerB);
+	PyMem_Free(offsetA);
+	PyMem_Free(offsetB);
+	PyMem_Free(scratch);
+	PyMem_Free(signalName);
+	PyMem_Free(job.columnA);
+	PyMem_Free(job.columnB);
+	PyMem_Free(job.isComplex);
+	PyMem_Free(job.maxError);
+	PyMem_Free(job.firstFailure);
+	PyMem_Free(job.failed);
+	PyMem_Free(job.error);
+	PyMem_Free(job.sweepValueB);
+	PyMem_Free(job.scaleRange);
+	PyMem_Free(job.rows);
+	Py_XDECREF(seq);
+	Py_XDECREF(errors);
+	Py_XDECREF(sweepValues);
+	Py_XDECREF(tables);
+	if(tuple != NULL) return tuple;
+	if(PyErr_Occurred()) return NULL;	// Propagate Python exceptions.
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+// Compare two floats for sorting, NaN goes last. Arguments:
+//   a ... pointer to the first float
+//   b ... pointer to the second float
+int compareFloats(const void *a, const void *b)
+{
+	float x = *(const float *)a, y = *(const float *)b;
+	if(x < y) return -1;
+	if(x > y) return 1;
+	return isnan(x) - isnan(y);
+}
+
+// Compare two sketch items by value for sorting, NaN goes last. Arguments:
+//   a ... pointer to the first item
+//   b ... pointer to the second item
+int compareSketchItems(const void *a, const void *b)
+{
+	double x = ((const struct SketchItem *)a)->value;
+	double y = ((const struct SketchItem *)b)->value;
+	if(x < y) return -1;
+	if(x > y) return 1;
+	return isnan(x) - isnan(y);
+}
+
+// Get number of items of a quantile sketch. Sketches are exact for fewer
+// observations. Argument:
+//   numOfQuantiles ... number of requested quantiles
+int sketchSize(int numOfQuantiles)
+{
+	return sketchItemsPerQuantile * (numOfQuantiles + 1);
+}
+
+// Compress a full quantile sketch to at most half of its items. This is a
+// variant of the merging t-digest (T. Dunning, O. Ertl, 2019) aimed at the
+// requested quantiles. Items are sorted and neighbours are replaced by their
+// weighted mean while the merged weight stays within a limit that grows with
+// the distance of its rank from the closest requested quantile, so items
+// close to a requested quantile stay light. The limit is doubled until the
+// items fit. Arguments:
+//   item           ... sketch items
+//   size           ... number of items, updated
+//   capacity       ... sketch items
+//   quantile       ... requested quantiles
+//   numOfQuantiles ... number of requested quantiles
+void sketchCompress(struct SketchItem *item, int *size, int capacity,
+					double *quantile, int numOfQuantiles)
+{
+	double total = 0.0, limit;
+	int i, k;
+	qsort(item, *size, sizeof(struct SketchItem), compareSketchItems);
+	for(i = 0; i < *size; i++) total = total + item[i].weight;
+	for(limit = 1.0; *size > capacity / 2; limit = 2 * limit)
+	{
+		double rank = 0.0;	// Weight of the items before the last kept one
+		int num = 0;
+		for(i = 1; i < *size; i++)
+		{
+			double weight = (double)item[num].weight + item[i].weight;
+			double q = (rank + weight / 2) / total, distance = 1.0;
+			for(k = 0; k < numOfQuantiles; k++)
+				if(fabs(q - quantile[k]) < distance) distance = fabs(q - quantile[k]);
+			if(weight <= limit * (distance * total + 1.0))
+			{
+				item[num].value = (float)(item[num].value + (item[i].weight / weight) *
+										  ((double)item[i].value - item[num].value));
+				item[num].weight = (float)weight;
+			}
+			else
+			{
+				rank = rank + item[num].weight;
+				num++;
+				item[num] = item[i];
+			}
+		}
+		*size = num + 1;
+	}
+}
+
+// Add an item to a quantile sketch, compress the sketch first if it is
+// full. Sketches are merged by adding the items of one to the other.
+// Arguments:
+//   item           ... sketch items
+//   size           ... number of items
+//   capacity       ... sketch items
+//   quantile       ... requested quantiles
+//   numOfQuantiles ... number of requested quantiles
+//   x              ... added item
+void sketchAdd(struct SketchItem *item, int *size, int capacity, double *quantile,
+			   int numOfQuantiles, struct SketchItem x)
+{
+	if(*size == capacity)
+		sketchCompress(item, size, capacity, quantile, numOfQuantiles);
+	item[*size] = x;
+	*size = *size + 1;
+}
+
+// Get quantile of sorted sketch items. An item of weight w covers w
+// observations and its value is placed at the middle of them. The quantile
+// is interpolated between the values of neighbouring items. For items of
+// weight 1 this is the interpolation of numpy.quantile(), so the result is
+// exact while the sketch was never compressed. Arguments:
+//   sorted ... sorted sketch items
+//   num    ... number of items
+//   n      ... number of observations
+//   p      ... quantile
+double sketchQuantile(struct SketchItem *sorted, int num, long n, double p)
+{
+	double position = (n - 1) * p + 0.5, before = 0.0, last = 0.0;
+	int i;
+	if(num < 1) return 0.0;
+	for(i = 0; i < num; i++)
+	{
+		double middle = before + sorted[i].weight / 2.0;
+		if(middle >= position)
+		{
+			if(i == 0) return sorted[0].value;
+			return lerp(sorted[i - 1].value, sorted[i].value,
+						(position - last) / (middle - last));
+		}
+		last = middle;
+		before = before + sorted[i].weight;
+	}
+	return sorted[num - 1].value;
+}
+
+// Fold tables into one set of partial statistics. Partial i takes tables i,
+// i + numOfPartials, ... Rows of every table are interpolated to the scale of
+// the first table. Arguments:
+//   context ... pointer to StatsJob structure
+//   index   ... partial statistics index
+void statsTask(void *context, int index)
+{
+	struct StatsJob *job = (struct StatsJob *)context;
+	struct StatsPartial *partial = &job->partial[index];
+	struct ScaleFollower fl;
+	int i, j;
+	npy_intp row;
+	float sweepValue;
+
+	for(i = index; i < job->header->sweepSize; i = i + job->numOfPartials)
+	{
+		long n = partial->count + 1;
+		job->error[i] = 1;
+		if(followerInit(&fl, job->debugMode, job->fileName, job->offset[i],
+						getNumOfColumns(job->header),
+						job->header->sweep != NULL ? &sweepValue : NULL))
+			goto statsTaskFailed;
+
+		for(row = 0; row < job->rows; row++)
+		{
+			double w;
+			float *lo, *hi;
+			if(followerSeek(&fl, job->scale[row], &lo, &hi, &w))
+				goto statsTaskFailed;
+
+			for(j = 0; j < job->numOfSignals; j++)
+			{
+				size_t point = (size_t)row * job->numOfSignals + j;
+				int c = job->column[j];
+				double x = lo[c] + w * ((double)hi[c] - lo[c]), delta;
+				struct SketchItem item;
+				if(job->isComplex[j])	// Complex vectors are folded by magnitude.
+					x = hypot(x, lo[c + 1] + w * ((double)hi[c + 1] - lo[c + 1]));
+
+				// Welford's update of mean and sum of squared deviations.
+				delta = x - partial->mean[point];
+				partial->mean[point] = partial->mean[point] + delta / n;
+				partial->m2[point] = partial->m2[point] +
+					delta * (x - partial->mean[point]);
+				if(n == 1 || x < partial->min[point]) partial->min[point] = x;
+				if(n == 1 || x > partial->max[point]) partial->max[point] = x;
+
+				item.value = (float)x;
+				item.weight = 1.0f;
+				sketchAdd(&partial->item[point * job->sketchSize], &partial->size[point],
+						  job->sketchSize, job->quantile, job->numOfQuantiles, item);
+			}
+		}
+
+		followerFree(&fl);
+		partial->count = n;
+		job->error[i] = 0;
+		continue;
+
+statsTaskFailed:
+		if(job->debugMode)
+			fprintf(debugFile, "HSpiceRead: failed to fold table %d.\n", i);
+		followerFree(&fl);
+		return;
+	}
+}
+
+// Release partial statistics. Argument:
+//   partial ... partial statistics
+void freeStatsPartial(struct StatsPartial *partial)
+{
+	PyMem_Free(partial->mean);
+	PyMem_Free(partial->m2);
+	PyMem_Free(partial->min);
+	PyMem_Free(partial->max);
+	PyMem_Free(partial->item);
+	PyMem_Free(partial->size);
+	memset(partial, 0, sizeof(struct StatsPartial));
+}
+
+// Read the scale of the first table. Returns:
+//   0 ... performed normally
+//   1 ... error occurred
+// Arguments:
+//   job ... statistics job, scale and rows are acquired
+int readReferenceScale(struct StatsJob *job)
+{
+	struct TableStream s;
+	FILE *f;
+	float *row = NULL, value;
+	size_t scaleSize = 0;
+	int num, numOfColumns = getNumOfColumns(job->header);
+
+	f = openTable(job->debugMode, job->fileName, job->offset[0]);
+	streamInit(&s, f, job->debugMode, job->fileName);
+	row = (float *)PyMem_Malloc(numOfColumns * sizeof(float));
+	if(f == NULL || row == NULL) goto readReferenceScaleFailed;
+	if(job->header->sweep != NULL && streamNextValue(&s, &value) != 0)
+		goto readReferenceScaleFailed;
+
+	job->rows = 0;
+	while((num = streamReadRow(&s, row, numOfColumns)) == 0)
+	{
+		if(ensureSpace(job->debugMode, (void **)&job->scale, &scaleSize,
+					   (job->rows + 1) * sizeof(double)))
+			goto readReferenceScaleFailed;
+		job->scale[job->rows] = row[0];
+		job->rows = job->rows + 1;
+	}
+	if(num > 0 || job->rows == 0) goto readReferenceScaleFailed;
+
+	streamFree(&s);
+	fclose(f);
+	PyMem_Free(row);
+	return 0;
+
+readReferenceScaleFailed:
+	if(job->debugMode) fprintf(debugFile, "HSpiceRead: failed to read scale.\n");
+	streamFree(&s);
+	if(f) fclose(f);
+	PyMem_Free(row);
+	return 1;
+}
+
+// Compute statistics of signals across all sweep tables of a file, e.g. the
+// samples of a Monte Carlo analysis, without keeping the tables in memory.
+// Tables are folded into partial statistics in parallel, partial statistics
+// are merged at the end.
+static PyObject *HSpiceStats(PyObject *self, PyObject *args)
+{
+	const char *fileName;
+	int debugMode, i, j, k, num, numOfThreads = 0;
+	long count;
+	size_t points, partialSize;
+	npy_intp dims[2];
+	double *scratch = NULL;
+	struct FastArray faScratch;
+	struct FileHeader header = {NULL, NULL};
+	struct StatsJob job;
+	FILE *f = NULL;
+	PyObject *signals = Py_None, *quantiles, *seq = NULL, *qseq = NULL,
+		*scale = NULL, *result = NULL, *arrays[5] = {NULL, NULL, NULL, NULL, NULL},
+		*item = NULL, *tuple = NULL;
+	const char **signalName = NULL;
+
+	memset(&job, 0, sizeof(job));
+
+	// Get hspice_stats() arguments.
+	if(!PyArg_ParseTuple(args, "siO|Oi", &fileName, &debugMode, &quantiles,
+						 &signals, &numOfThreads))
+		return NULL;
+
+	if(debugMode) fprintf(debugFile, "HSpiceRead: folding file %s.\n", fileName);
+
+	f = fopen(fileName, "rb");	// Open the file and parse its header.
 	if(f == NULL)
 	{
 		if(debugMode)
 			fprintf(debugFile, "HSpiceRead: cannot open file %s.\n", fileName);
-		goto failed;
+		goto statsFailed;
+	}
+	if(readFileHeader(f, debugMode, fileName, &header)) goto statsFailed;
+	if(header.sweepSize < 1)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: no tables in file.\n");
+		goto statsFailed;
 	}
 
-	num = getc(f);
-	ungetc(num, f);
-	if(num == EOF)	// Test if there is data in the file.
+	// Collect table positions.
+	job.offset = (FileOffset *)PyMem_Malloc(header.sweepSize * sizeof(FileOffset));
+	scratch = (double *)PyMem_Malloc(header.sweepSize * sizeof(double));
+	job.error = (int *)PyMem_Malloc(header.sweepSize * sizeof(int));
+	if(job.offset == NULL || scratch == NULL || job.error == NULL)
 	{
 		if(debugMode)
-			fprintf(debugFile, "HSpiceRead: file %s is empty.\n", fileName);
-		goto failed;
+			fprintf(debugFile, "HSpiceRead: cannot allocate table positions.\n");
+		goto statsFailed;
 	}
-	if((num & 0x000000ff) >= ' ')	// Test if the file is in binary format.
+	faScratch.data = faScratch.pos = (char *)scratch;
+	faScratch.stride = sizeof(double);
+	faScratch.length = header.sweepSize;
+	if(scanTables(f, debugMode, fileName, header.sweepSize, job.offset, NULL,
+				  &faScratch))
+		goto statsFailed;
+	fclose(f);
+	f = NULL;
+
+	// Get quantiles.
+	qseq = PySequence_Fast(quantiles, "quantiles must be a sequence");
+	if(qseq == NULL) goto statsFailed;
+	job.numOfQuantiles = PySequence_Fast_GET_SIZE(qseq);
+	job.quantile = (double *)PyMem_Malloc((job.numOfQuantiles + 1) * sizeof(double));
+	if(job.quantile == NULL) goto statsFailed;
+	for(i = 0; i < job.numOfQuantiles; i++)
 	{
-		if(debugMode) fprintf(debugFile,
-							  "HSpiceRead: file %s is in ascii format.\n",
-							  fileName);
-		goto failed;
+		job.quantile[i] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(qseq, i));
+		if(PyErr_Occurred()) goto statsFailed;
+		if(job.quantile[i] < 0.0 || job.quantile[i] > 1.0)
+		{
+			PyErr_SetString(PyExc_ValueError, "quantiles must be between 0 and 1");
+			goto statsFailed;
+		}
+	}
+
+	// Get names of signals, all vectors except scale by default.
+	if(signals == Py_None) job.numOfSignals = header.numOfVectors - 1;
+	else
+	{
+		seq = PySequence_Fast(signals, "signals must be a sequence of names");
+		if(seq == NULL) goto statsFailed;
+		job.numOfSignals = PySequence_Fast_GET_SIZE(seq);
+	}
+	signalName = (const char **)PyMem_Malloc((job.numOfSignals + 1) * sizeof(char *));
+	job.column = (int *)PyMem_Malloc((job.numOfSignals + 1) * sizeof(int));
+	job.isComplex = (int *)PyMem_Malloc((job.numOfSignals + 1) * sizeof(int));
+	if(signalName == NULL || job.column == NULL || job.isComplex == NULL)
+	{
+		if(debugMode) fprintf(debugFile, "HSpiceRead: cannot allocate signals.\n");
+		goto statsFailed;
 	}
-
-	// Read file header blocks.
-	do num = readHeaderBlock(f, debugMode, fileName, &buf, &offset);
-	while(num == 0);
-	if(num > 0) goto failed;
-
- 	// Check version of post format.
-	if(strncmp(&buf[postStartPosition1], postString11, numOfPostCharacters) != 0 &&
-	   strncmp(&buf[postStartPosition1], postString12, numOfPostCharacters) != 0 &&
-	   strncmp(&buf[postStartPosition2], postString21, numOfPostCharacters) != 0)
+	for(i = 0; i < job.numOfSignals; i++)
 	{
-		if(debugMode) fprintf(debugFile, "HSpiceRead: unknown post format.\n");
-		goto failed;
+		int vector;
+		if(seq == NULL) signalName[i] = header.name[i];
+		else
+		{
+			signalName[i] = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq, i));
+			if(signalName[i] == NULL) goto statsFailed;
+		}
+		vector = findVector(&header, signalName[i]);
+		if(vector < 0)
+		{
+			if(debugMode) fprintf(debugFile,
+								  "HSpiceRead: signal %s not found.\n", signalName[i]);
+			PyErr_SetString(PyExc_KeyError, signalName[i]);
+			goto statsFailed;
+		}
+		job.column[i] = getVectorColumn(&header, vector);
+		job.isComplex[i] = isComplexVector(&header, vector);
 	}
 
-	buf[dateEndPosition] = 0;
-	date = PyUnicode_FromString(&buf[dateStartPosition]);	// Get creation date.
-	if(date == NULL)
+	job.fileName = fileName;
+	job.debugMode = debugMode;
+	job.header = &header;
+	if(readReferenceScale(&job)) goto statsFailed;
+
+	// Allocate partial statistics, one per thread. Their size depends on the
+	// number of scale points and quantiles, but not on the number of tables.
+	// Fewer threads are used if the partial statistics would not fit into
+	// statsMemorySize.
+	job.sketchSize = sketchSize(job.numOfQuantiles);
+	points = (size_t)job.rows * job.numOfSignals;
+	partialSize = points * (4 * sizeof(double) + sizeof(int) +
+							job.sketchSize * sizeof(struct SketchItem));
+	numOfThreads = getNumOfThreads(numOfThreads, header.sweepSize);
+	if((double)numOfThreads * partialSize > statsMemorySize)
+		numOfThreads = (int)(statsMemorySize / partialSize);
+	if(numOfThreads < 1) numOfThreads = 1;
+	job.numOfPartials = numOfThreads;
+	job.partial = (struct StatsPartial *)PyMem_Malloc(
+		numOfThreads * sizeof(struct StatsPartial));
+	if(job.partial == NULL) goto statsFailed;
+	memset(job.partial, 0, numOfThreads * sizeof(struct StatsPartial));
+	for(i = 0; i < numOfThreads; i++)
 	{
-		if(debugMode)
-			fprintf(debugFile, "HSpiceRead: failed to create date string.\n");
-		goto failed;
+		struct StatsPartial *partial = &job.partial[i];
+		partial->mean = (double *)PyMem_Malloc(points * sizeof(double));
+		partial->m2 = (double *)PyMem_Malloc(points * sizeof(double));
+		partial->min = (double *)PyMem_Malloc(points * sizeof(double));
+		partial->max = (double *)PyMem_Malloc(points * sizeof(double));
+		partial->item = (struct SketchItem *)PyMem_Malloc(
+			points * job.sketchSize * sizeof(struct SketchItem));
+		partial->size = (int *)PyMem_Malloc(points * sizeof(int));
+		if(partial->mean == NULL || partial->m2 == NULL || partial->min == NULL ||
+		   partial->max == NULL || partial->item == NULL || partial->size == NULL)
+		{
+			if(debugMode)
+				fprintf(debugFile, "HSpiceRead: cannot allocate statistics.\n");
+			goto statsFailed;
+		}
+		memset(partial->mean, 0, points * sizeof(double));
+		memset(partial->m2, 0, points * sizeof(double));
+		memset(partial->size, 0, points * sizeof(int));
 	}
 
-	while(buf[i] == ' ') i--;
-	buf[i + 1] = 0;
-	title = PyUnicode_FromString(&buf[titleStartPosition]);	// Get title.
-	if(title == NULL)
+	// Fold tables.
+	Py_BEGIN_ALLOW_THREADS
+	runParallel(numOfThreads, numOfThreads, statsTask, &job);
+	Py_END_ALLOW_THREADS
+	for(i = 0; i < header.sweepSize; i++) if(job.error[i]) goto statsFailed;
+
+	// Merge partial statistics into the first one. Means and sums of squared
+	// deviations are merged exactly (T. F. Chan et al., 1979). Quantile
+	// sketches are merged by adding the items of one to the other.
+	count = job.partial[0].count;
+	for(i = 1; i < numOfThreads; i++)
 	{
-		if(debugMode)
-			fprintf(debugFile, "HSpiceRead: failed to create title string.\n");
-		goto failed;
+		struct StatsPartial *a = &job.partial[0], *b = &job.partial[i];
+		size_t point;
+		long n = count + b->count;
+		if(b->count == 0) continue;
+		for(point = 0; point < points; point++)
+		{
+			double delta = b->mean[point] - a->mean[point];
+			size_t sketch = point * job.sketchSize;
+			if(count == 0)
+			{
+				a->min[point] = b->min[point];
+				a->max[point] = b->max[point];
+			}
+			a->mean[point] = a->mean[point] + delta * b->count / n;
+			a->m2[point] = a->m2[point] + b->m2[point] +
+				delta * delta * ((double)count * b->count / n);
+			if(b->min[point] < a->min[point]) a->min[point] = b->min[point];
+			if(b->max[point] > a->max[point]) a->max[point] = b->max[point];
+			for(k = 0; k < b->size[point]; k++)
+				sketchAdd(&a->item[sketch], &a->size[point], job.sketchSize,
+						  job.quantile, job.numOfQuantiles, b->item[sketch + k]);
+		}
+		count = n;
 	}
 
-	buf[numOfSweepsEndPosition] = 0;	// Check number of sweep parameters.
-	num = atoi(&buf[numOfSweepsPosition]);
-	if(num < 0 || num > 1) 
+	// Create result arrays.
+	dims[0] = job.rows;
+	scale = PyArray_SimpleNew(1, dims, PyArray_DOUBLE);
+	result = PyDict_New();
+	if(scale == NULL || result == NULL) goto statsFailed;
+	memcpy(((PyArrayObject *)scale)->data, job.scale, job.rows * sizeof(double));
+	for(j = 0; j < job.numOfSignals; j++)
 	{
-		if(debugMode) fprintf(debugFile,
-							  "HSpiceRead: only onedimensional sweep supported.\n");
-		goto failed;
+		double *mean, *std, *min, *max, *quantile;
+		npy_intp row;
+		for(k = 0; k < 4; k++)
+		{
+			arrays[k] = PyArray_SimpleNew(1, dims, PyArray_DOUBLE);
+			if(arrays[k] == NULL) goto statsFailed;
+		}
+		dims[0] = job.numOfQuantiles;
+		dims[1] = job.rows;
+		arrays[4] = PyArray_SimpleNew(2, dims, PyArray_DOUBLE);
+		dims[0] = job.rows;
+		if(arrays[4] == NULL) goto statsFailed;
+		mean = (double *)((PyArrayObject *)arrays[0])->data;
+		std = (double *)((PyArrayObject *)arrays[1])->data;
+		min = (double *)((PyArrayObject *)arrays[2])->data;
+		max = (double *)((PyArrayObject *)arrays[3])->data;
+		quantile = (double *)((PyArrayObject *)arrays[4])->data;
+
+		for(row = 0; row < job.rows; row++)
+		{
+			size_t point = (size_t)row * job.numOfSignals + j;
+			struct SketchItem *sorted = &job.partial[0].item[point * job.sketchSize];
+			mean[row] = job.partial[0].mean[point];
+			std[row] = count > 1 ? sqrt(job.partial[0].m2[point] / (count - 1)) : 0.0;
+			min[row] = job.partial[0].min[point];
+			max[row] = job.partial[0].max[point];
+			num = job.partial[0].size[point];
+			qsort(sorted, num, sizeof(struct SketchItem), compareSketchItems);
+			for(k = 0; k < job.numOfQuantiles; k++)
+			{
+				// Extremes are exact, the sketch may have dropped them.
+				double value = sketchQuantile(sorted, num, count, job.quantile[k]);
+				if(job.quantile[k] == 0.0 || value < min[row]) value = min[row];
+				if(job.quantile[k] == 1.0 || value > max[row]) value = max[row];
+				quantile[(size_t)k * job.rows + row] = value;
+			}
+		}
+
+		item = PyTuple_Pack(5, arrays[0], arrays[1], arrays[2], arrays[3], arrays[4]);
+		for(k = 0; k < 5; k++) Py_CLEAR(arrays[k]);
+		if(item == NULL) goto statsFailed;
+		num = PyDict_SetItemString(result, signalName[j], item);
+		Py_CLEAR(item);
+		if(num) goto statsFailed;
 	}
 
-	buf[numOfSweepsPosition] = 0;	// Get number of vectors (variables and probes).
-	numOfVectors = atoi(&buf[numOfProbesPosition]);
-	buf[numOfProbesPosition] = 0;
-	numOfVariables = atoi(&buf[numOfVariablesPosition]);	// Scale included.
-	numOfVectors = numOfVectors + numOfVariables;
+	tuple = Py_BuildValue("(sOlO)", header.scale, scale, count, result);
+
+statsFailed:	// Also reached on success, tuple is NULL on failure.
+	if(f) fclose(f);
+	freeFileHeader(&header);
+	PyMem_Free(job.offset);
+	PyMem_Free(job.error);
+	PyMem_Free(job.quantile);
+	PyMem_Free(job.column);
+	PyMem_Free(job.isComplex);
+	PyMem_RawFree(job.scale);
+	if(job.partial != NULL)
+		for(i = 0; i < job.numOfPartials; i++) freeStatsPartial(&job.partial[i]);
+	PyMem_Free(job.partial);
+	PyMem_Free(scratch);
+	PyMem_Free(signalName);
+	for(k = 0; k < 5; k++) Py_XDECREF(arrays[k]);
+	Py_XDECREF(seq);
+	Py_XDECREF(qseq);
+	Py_XDECREF(scale);
+	Py_XDECREF(result);
+	if(tuple != NULL) return tuple;
+	if(PyErr_Occurred()) return NULL;	// Propagate Python exceptions.
+	Py_INCREF(Py_None);
+	return Py_None;
+}
 
-	// Get type of variables. Scale is always real.
-	token = strtok(&buf[vectorDescriptionStartPosition], " \t\n");
-	type = atoi(token);
-	if(type == frequency) type = complex_var;
-	else type = real_var;
+// Copy a string into memory that can be released without the GIL. Returns:
+//   NULL    ... allocation failed
+//   pointer ... copy of the string
+// Argument:
+//   s ... string to copy
+char *rawStrdup(const char *s)
+{
+	char *copy = (char *)PyMem_RawMalloc(strlen(s) + 1);
+	if(copy != NULL) strcpy(copy, s);
+	return copy;
+}
 
-	for(i = 0; i < numOfVectors; i++) token = strtok(NULL, " \t\n");
-	if(token == NULL)
+// Release callback of an exported column schema.
+void arrowReleaseChildSchema(struct ArrowSchema *schema)
+{
+	PyMem_RawFree((void *)schema->name);
+	schema->release = NULL;
+}
+
+// Release callback of an exported record batch schema.
+void arrowReleaseSchema(struct ArrowSchema *schema)
+{
+	int64_t i;
+	for(i = 0; i < schema->n_children; i++)
+		if(schema->children[i]->release != NULL)
+			schema->children[i]->release(schema->children[i]);
+	PyMem_RawFree(schema->private_data);	// Holds the children.
+	schema->release = NULL;
+}
+
+// Release callback of an exported column. The column owns its buffer.
+void arrowReleaseChildArray(struct ArrowArray *array)
+{
+	PyMem_RawFree((void *)array->buffers[1]);
+	PyMem_RawFree(array->private_data);	// Holds the buffer pointers.
+	array->release = NULL;
+}
+
+// Release callback of an exported record batch.
+void arrowReleaseArray(struct ArrowArray *array)
+{
+	int64_t i;
+	for(i = 0; i < array->n_children; i++)
+		if(array->children[i]->release != NULL)
+			array->children[i]->release(array->children[i]);
+	PyMem_RawFree(array->private_data);	// Holds the children.
+	array->release = NULL;
+}
+
+// Stream callback, describes the record batches of the stream. Every column
+// is a float64 column. Returns 0 on success or an errno value.
+int arrowGetSchema(struct ArrowArrayStream *stream, struct ArrowSchema *out)
+{
+	struct ArrowExport *e = (struct ArrowExport *)stream->private_data;
+	struct ArrowSchema **children, *child;
+	int i, n = e->numOfFields;
+
+	// Children pointers and children are allocated in one block.
+	children = (struct ArrowSchema **)PyMem_RawMalloc(
+		n * (sizeof(struct ArrowSchema *) + sizeof(struct ArrowSchema)));
+	if(children == NULL)
 	{
-		if(debugMode) fprintf(debugFile,
-							  "HSpiceRead: failed to extract independent variable name.\n");
-		goto failed;
+		snprintf(e->lastError, sizeof(e->lastError), "cannot allocate schema");
+		return ENOMEM;
+	}
+	child = (struct ArrowSchema *)(children + n);
+
+	out->format = "+s";
+	out->name = "";
+	out->metadata = NULL;
+	out->flags = 0;
+	out->n_children = n;
+	out->children = children;
+	out->dictionary = NULL;
+	out->release = arrowReleaseSchema;
+	out->private_data = children;
+
+	for(i = 0; i < n; i++)
+	{
+		children[i] = &child[i];
+		child[i].format = "g";
+		child[i].name = rawStrdup(e->fieldName[i]);
+		child[i].metadata = NULL;
+		child[i].flags = 0;
+		child[i].n_children = 0;
+		child[i].children = NULL;
+		child[i].dictionary = NULL;
+		child[i].release = arrowReleaseChildSchema;
+		child[i].private_data = NULL;
+		if(child[i].name == NULL)
+		{
+			out->n_children = i + 1;
+			arrowReleaseSchema(out);
+			snprintf(e->lastError, sizeof(e->lastError), "cannot allocate schema");
+			return ENOMEM;
+		}
 	}
+	return 0;
+}
 
-	scale = PyUnicode_FromString(token);	// Get independent variable name.
-	if(scale == NULL)
+// Stream callback, decodes the next table into a record batch. The number
+// of rows is known from the scan of the file, so every column gets a buffer
+// of exact size which is handed over to the consumer. The raw data of the
+// table is read into the scratch space of the stream and decoded into the
+// column buffers range by range. Returns 0 on success or an errno value. At
+// the end of the stream out is marked as released.
+int arrowGetNext(struct ArrowArrayStream *stream, struct ArrowArray *out)
+{
+	struct ArrowExport *e = (struct ArrowExport *)stream->private_data;
+	struct ArrowArray **children = NULL, *child;
+	struct DecodeJob job;
+	double **data = NULL;
+	float *rawDataPos;
+	size_t count, size;
+	npy_intp row, rows;
+	int i, numOfTasks, n = e->numOfFields;
+
+	memset(out, 0, sizeof(struct ArrowArray));
+	if(e->next >= e->sweepSize) return 0;	// End of stream.
+	size = e->tableSize[e->next];
+	if(size < (size_t)(e->sweep + 1)) goto arrowReadFailed;
+	rows = (size - e->sweep - 1) / e->numOfColumns;
+
+	// Allocate column buffers.
+	data = (double **)PyMem_RawCalloc(n + 1, sizeof(double *));
+	if(data == NULL) goto arrowAllocFailed;
+	for(i = 0; i < n; i++)
 	{
-		if(debugMode) fprintf(debugFile,
-							  "HSpiceRead: failed to create independent variable name string.\n");
-		goto failed;
+		data[i] = (double *)PyMem_RawMalloc(rows > 0 ? rows * sizeof(double) : 1);
+		if(data[i] == NULL) goto arrowAllocFailed;
 	}
 
-	// Allocate space for pointers to vector names.
-	name = (char **)PyMem_Malloc((numOfVectors - 1) * sizeof(char *));
-	if(name == NULL)
+	// Read raw data of the table. The scratch space has the size of the
+	// largest table read so far.
+	if(fileSeek(e->f, e->offset[e->next], SEEK_SET) != 0)
 	{
-		if(debugMode) fprintf(debugFile,
-							  "HSpiceRead: cannot allocate pointers to vector names.\n");
-		goto failed;
+		snprintf(e->lastError, sizeof(e->lastError), "failed to seek in file");
+		goto arrowGetNextFailed;
 	}
+	if(readRawTable(e->f, e->debugMode, e->fileName, &e->buffers, &count) ||
+	   count != size)
+		goto arrowReadFailed;
 
-	for(i = 0; i < numOfVectors - 1; i++)	// Get vector names.
+	// Decode file columns into column buffers, the sweep value is repeated.
+	rawDataPos = e->buffers.rawData + e->sweep;
+	for(i = 0; i < n; i++)
 	{
-		name[i] = strtok(NULL, " \t\n");
-		if(name[i] == NULL)
+		if(e->fieldColumn[i] >= 0)
 		{
-			if(debugMode) fprintf(debugFile,
-								  "HSpiceRead: failed to extract vector names.\n");
-			goto failed;
+			e->buffers.faPtr[e->fieldColumn[i]].data = (char *)data[i];
+			e->buffers.faPtr[e->fieldColumn[i]].stride = sizeof(double);
 		}
+		else for(row = 0; row < rows; row++) data[i][row] = e->buffers.rawData[0];
 	}
-
-	// Process vector names: make name lowercase, remove v( in front of name
-	for(i=0; i < numOfVectors - 1; i++) {
-		int j;
-		for(j=0;name[i][j];j++) {
-			if (name[i][j]>='A' && name[i][j]<='Z') {
-				name[i][j]-='A'-'a';
-			}
-		}
-		if (name[i][0]=='v' && name[i][1]=='(') {
-			for(j=2;name[i][j];j++) {
-				name[i][j-2]=name[i][j];
-			}
-			name[i][j-2]=0;
+	job.rawData = rawDataPos;
+	job.faPtr = e->buffers.faPtr;
+	job.numOfVectors = e->numOfColumns;
+	job.numOfVariables = e->numOfColumns;
+	job.type = real_var;
+	job.numOfColumns = e->numOfColumns;
+	job.rows = rows;
+	job.rowsPerTask = decodeRangeSize / e->numOfColumns + 1;
+	numOfTasks = (int)((rows + job.rowsPerTask - 1) / job.rowsPerTask);
+	for(i = 0; i < numOfTasks; i++) decodeRows(&job, i);
+
+	// Children pointers, children and the batch buffer pointer are allocated
+	// in one block.
+	children = (struct ArrowArray **)PyMem_RawMalloc(
+		n * (sizeof(struct ArrowArray *) + sizeof(struct ArrowArray)) +
+		sizeof(void *));
+	if(children == NULL) goto arrowAllocFailed;
+	child = (struct ArrowArray *)(children + n);
+	for(i = 0; i < n; i++)
+	{
+		const void **buffers = (const void **)PyMem_RawMalloc(2 * sizeof(void *));
+		if(buffers == NULL)
+		{
+			while(i-- > 0) PyMem_RawFree(child[i].private_data);
+			goto arrowAllocFailed;
 		}
+		buffers[0] = NULL;	// No validity bitmap, there are no nulls.
+		buffers[1] = data[i];
+		children[i] = &child[i];
+		child[i].length = rows;
+		child[i].null_count = 0;
+		child[i].offset = 0;
+		child[i].n_buffers = 2;
+		child[i].n_children = 0;
+		child[i].buffers = buffers;
+		child[i].children = NULL;
+		child[i].dictionary = NULL;
+		child[i].release = arrowReleaseChildArray;
+		child[i].private_data = buffers;
 	}
 
-	if(num == 1)	// Get sweep information.
+	out->length = rows;
+	out->null_count = 0;
+	out->offset = 0;
+	out->n_buffers = 1;
+	out->n_children = n;
+	out->buffers = (const void **)(child + n);
+	out->buffers[0] = NULL;
+	out->children = children;
+	out->dictionary = NULL;
+	out->release = arrowReleaseArray;
+	out->private_data = children;
+
+	PyMem_RawFree(data);
+	e->next = e->next + 1;
+	return 0;
+
+arrowAllocFailed:
+	snprintf(e->lastError, sizeof(e->lastError), "cannot allocate record batch");
+	if(data != NULL) for(i = 0; i < n; i++) PyMem_RawFree(data[i]);
+	PyMem_RawFree(data);
+	PyMem_RawFree(children);
+	return ENOMEM;
+
+arrowReadFailed:
+	snprintf(e->lastError, sizeof(e->lastError), "failed to read table %d",
+			 e->next);
+arrowGetNextFailed:
+	if(data != NULL) for(i = 0; i < n; i++) PyMem_RawFree(data[i]);
+	PyMem_RawFree(data);
+	return EIO;
+}
+
+// Stream callback, returns the description of the last error.
+const char *arrowGetLastError(struct ArrowArrayStream *stream)
+{
+	struct ArrowExport *e = (struct ArrowExport *)stream->private_data;
+	return e->lastError[0] ? e->lastError : NULL;
+}
+
+// Release callback of an exported stream, closes the file.
+void arrowReleaseStream(struct ArrowArrayStream *stream)
+{
+	struct ArrowExport *e = (struct ArrowExport *)stream->private_data;
+	int i;
+	if(e->f) fclose(e->f);
+	for(i = 0; i < e->numOfFields; i++) PyMem_RawFree(e->fieldName[i]);
+	PyMem_RawFree(e->fieldName);
+	PyMem_RawFree(e->fieldColumn);
+	PyMem_RawFree(e->offset);
+	PyMem_RawFree(e->tableSize);
+	freeReadBuffers(&e->buffers);
+	PyMem_RawFree(e->fileName);
+	PyMem_RawFree(e);
+	stream->release = NULL;
+}
+
+// Destructor of the capsule holding an exported stream. Releases the stream
+// unless the consumer has taken it over.
+void arrowCapsuleDestructor(PyObject *capsule)
+{
+	struct ArrowArrayStream *stream = (struct ArrowArrayStream *)
+		PyCapsule_GetPointer(capsule, "arrow_array_stream");
+	if(stream == NULL) return;
+	if(stream->release != NULL) stream->release(stream);
+	PyMem_RawFree(stream);
+}
+
+// Add an exported column. Returns:
+//   0 ... performed normally
+//   1 ... allocation failed
+// Arguments:
+//   e      ... export structure with enough room for columns
+//   prefix ... prefix of column name, NULL for none
+//   name   ... name of the column
+//   column ... position within a file row, -1 for sweep value
+int arrowAddField(struct ArrowExport *e, const char *prefix, const char *name,
+				  int column)
+{
+	char *fieldName;
+	if(prefix == NULL) fieldName = rawStrdup(name);
+	else
 	{
-		int num = getSweepInfo(debugMode, &sweep, buf, &sweepSize, &sweepValues,
-							   &faSweep);
-		if(num) goto failed;
+		fieldName = (char *)PyMem_RawMalloc(strlen(prefix) + strlen(name) + 3);
+		if(fieldName != NULL) sprintf(fieldName, "%s(%s)", prefix, name);
 	}
+	if(fieldName == NULL) return 1;
+	e->fieldName[e->numOfFields] = fieldName;
+	e->fieldColumn[e->numOfFields] = column;
+	e->numOfFields = e->numOfFields + 1;
+	return 0;
+}
 
-	dataList = PyList_New(0);	// Create an empty list for data dictionaries.
-	if(dataList == NULL)
+// Export a HSpice output file as an Arrow C stream with one record batch per
+// table. Tables are decoded when the consumer asks for them. Returns a
+// capsule named arrow_array_stream as required by the Arrow PyCapsule
+// interface.
+static PyObject *HSpiceArrow(PyObject *self, PyObject *args)
+{
+	const char *fileName;
+	int debugMode, sweepColumn, i, num;
+	double *scratch = NULL;
+	struct FastArray faScratch;
+	struct FileHeader header = {NULL, NULL};
+	struct ArrowExport *e = NULL;
+	struct ArrowArrayStream *stream = NULL;
+	PyObject *capsule;
+
+	// Get hspice_arrow() arguments.
+	if(!PyArg_ParseTuple(args, "sii", &fileName, &debugMode, &sweepColumn))
+		return NULL;
+
+	if(debugMode) fprintf(debugFile, "HSpiceRead: exporting file %s.\n", fileName);
+
+	// The stream may be released without holding the GIL, so everything it
+	// owns is allocated with the raw allocator.
+	e = (struct ArrowExport *)PyMem_RawCalloc(1, sizeof(struct ArrowExport));
+	if(e == NULL) goto arrowFailed;
+	e->debugMode = debugMode;
+	e->fileName = rawStrdup(fileName);
+	if(e->fileName == NULL) goto arrowFailed;
+
+	e->f = fopen(fileName, "rb");	// Open the file and parse its header.
+	if(e->f == NULL)
 	{
 		if(debugMode)
-			fprintf(debugFile, "HSpiceRead: failed to create data list.\n");
-		goto failed;
+			fprintf(debugFile, "HSpiceRead: cannot open file %s.\n", fileName);
+		goto arrowFailed;
 	}
-
-	// Allocate space for pointers to arrays.
-	tmpArray = (PyObject **)PyMem_Malloc(numOfVectors * sizeof(PyObject *));
-	if(tmpArray == NULL)
+	if(readFileHeader(e->f, debugMode, fileName, &header)) goto arrowFailed;
+
+	// Collect table positions.
+	e->sweep = header.sweep != NULL;
+	e->sweepSize = header.sweepSize;
+	e->numOfColumns = getNumOfColumns(&header);
+	e->offset = (FileOffset *)PyMem_RawMalloc(header.sweepSize * sizeof(FileOffset));
+	e->tableSize = (size_t *)PyMem_RawMalloc(header.sweepSize * sizeof(size_t));
+	scratch = (double *)PyMem_Malloc(header.sweepSize * sizeof(double));
+	if(e->offset == NULL || e->tableSize == NULL || scratch == NULL)
+		goto arrowFailed;
+	faScratch.data = faScratch.pos = (char *)scratch;
+	faScratch.stride = sizeof(double);
+	faScratch.length = header.sweepSize;
+	if(scanTables(e->f, debugMode, fileName, header.sweepSize, e->offset,
+				  e->tableSize, &faScratch))
+		goto arrowFailed;
+
+	// Describe columns: sweep value, scale and vectors. Complex vectors are
+	// exported as two columns, real(name) and imag(name).
+	e->fieldName = (char **)PyMem_RawMalloc((e->numOfColumns + 1) * sizeof(char *));
+	e->fieldColumn = (int *)PyMem_RawMalloc((e->numOfColumns + 1) * sizeof(int));
+	if(e->fieldName == NULL || e->fieldColumn == NULL) goto arrowFailed;
+	if(e->sweep && sweepColumn && arrowAddField(e, NULL, header.sweep, -1))
+		goto arrowFailed;
+	for(i = 0; i < header.numOfVectors; i++)
 	{
-		if(debugMode)
-			fprintf(debugFile, "HSpiceRead: cannot allocate pointers to arrays.\n");
-		goto failed;
+		const char *name = i == 0 ? header.scale : header.name[i - 1];
+		int column = getVectorColumn(&header, i);
+		if(isComplexVector(&header, i))
+			num = arrowAddField(e, "real", name, column) ||
+				arrowAddField(e, "imag", name, column + 1);
+		else num = arrowAddField(e, NULL, name, column);
+		if(num) goto arrowFailed;
 	}
-
-	// Allocate space for fast array pointers.
-	faPtr =
-		(struct FastArray *)PyMem_Malloc(numOfVectors * sizeof(struct FastArray));
-	if(faPtr == NULL)
+	if(reserveVectors(debugMode, &e->buffers, e->numOfColumns)) goto arrowFailed;
+	freeFileHeader(&header);
+	PyMem_Free(scratch);
+	scratch = NULL;
+
+	stream = (struct ArrowArrayStream *)PyMem_RawMalloc(
+		sizeof(struct ArrowArrayStream));
+	if(stream == NULL) goto arrowFailed;
+	stream->get_schema = arrowGetSchema;
+	stream->get_next = arrowGetNext;
+	stream->get_last_error = arrowGetLastError;
+	stream->release = arrowReleaseStream;
+	stream->private_data = e;
+
+	capsule = PyCapsule_New(stream, "arrow_array_stream", arrowCapsuleDestructor);
+	if(capsule == NULL)
 	{
-		if(debugMode) fprintf(debugFile, "HSpiceRead: failed to create array.\n");
-		goto failed;
+		stream->release(stream);
+		PyMem_RawFree(stream);
+		return NULL;
 	}
+	return capsule;
 
-	for(i = 0; i < sweepSize; i++)	// Read i-th table.
+arrowFailed:
+	if(debugMode) fprintf(debugFile, "HSpiceRead: failed to export file.\n");
+	freeFileHeader(&header);
+	PyMem_Free(scratch);
+	if(e != NULL)
 	{
-		num = readTable(f, debugMode, fileName, sweep, numOfVariables, type,
-						numOfVectors, &faSweep, tmpArray, faPtr, token, name,
-						dataList);
-		if(num) goto failed;
+		struct ArrowArrayStream tmp;
+		tmp.private_data = e;
+		arrowReleaseStream(&tmp);
 	}
-	fclose(f);
-	f = NULL;
-	PyMem_Free(faPtr);
-	faPtr = NULL;
-	PyMem_Free(buf);
-	buf = NULL;
-	PyMem_Free(name);
-	name = NULL;
-	PyMem_Free(tmpArray);
-	tmpArray = NULL;
+	if(PyErr_Occurred()) return NULL;	// Propagate Python exceptions.
+	Py_INCREF(Py_None);
+	return Py_None;
+}
 
-	// Create sweeps tuple.
-	if(sweep == NULL) sweeps = PyTuple_Pack(3, Py_None, Py_None, dataList);
-	else sweeps = PyTuple_Pack(3, sweep, sweepValues, dataList);
-	if(sweeps == NULL)
+// Reader object initialization. Arguments:
+//   debug       ... debug messages flag (optional)
+//   threads     ... number of threads for decoding large tables, 0 or less for
+//                   one thread per processor (optional)
+//   max_scratch ... scratch space in bytes kept after a read, 0 for no limit
+//                   (optional)
+static int Reader_init(ReaderObject *self, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = {"debug", "threads", "max_scratch", NULL};
+	int debugMode = 0, numOfThreads = 0;
+	Py_ssize_t maxScratch = 0;
+	if(!PyArg_ParseTupleAndKeywords(args, kwds, "|iin", kwlist, &debugMode,
+									&numOfThreads, &maxScratch))
+		return -1;
+	self->debugMode = debugMode;
+	self->numOfThreads = numOfThreads;
+	self->maxScratch = maxScratch > 0 ? (size_t)maxScratch : 0;
+	return 0;
+}
+
+// Mark a reader as busy. Large tables are decoded without the GIL, so
+// another thread could otherwise use the scratch space in the meantime.
+// Returns:
+//   0 ... performed normally
+//   1 ... reader is busy, Python exception set
+// Argument:
+//   self ... reader object
+int acquireReader(ReaderObject *self)
+{
+	if(self->busy)
 	{
-		if(debugMode) fprintf(debugFile,
-							  "HSpiceRead: failed to create tuple with sweeps.\n");
-		goto failed;
+		PyErr_SetString(PyExc_RuntimeError, "reader is used by another thread");
+		return 1;
 	}
-	Py_XDECREF(sweep);
-	Py_XDECREF(sweepValues);
-	Py_XDECREF(dataList);
+	self->busy = 1;
+	return 0;
+}
 
-	// Prepare return tuple.
-	tuple = PyTuple_Pack(6, sweeps, scale, Py_None, title, date, Py_None);
-	if(tuple == NULL)
+// Release scratch space of a reader if it is larger than its limit. The
+// header layout cache is kept. Argument:
+//   self ... reader object
+void trimScratch(ReaderObject *self)
+{
+	if(self->maxScratch > 0 && readBuffersSize(&self->buffers) > self->maxScratch)
+		freeReadBuffers(&self->buffers);
+}
+
+// Release scratch space and cached header layout of a reader.
+static PyObject *Reader_clear(ReaderObject *self, PyObject *args)
+{
+	if(acquireReader(self)) return NULL;
+	freeReadBuffers(&self->buffers);
+	freeHeaderCache(&self->cache);
+	self->busy = 0;
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+// Get size of scratch space kept by a reader in bytes.
+static PyObject *Reader_scratchSize(ReaderObject *self, PyObject *args)
+{
+	return PyLong_FromSize_t(readBuffersSize(&self->buffers));
+}
+
+// Reader object destruction, releases scratch space and cached header layout.
+static void Reader_dealloc(ReaderObject *self)
+{
+	freeReadBuffers(&self->buffers);
+	freeHeaderCache(&self->cache);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// Read a file like hspice_read() does, reusing the scratch space of the
+// reader. Arguments:
+//   fileName ... name of the file
+//   select   ... sweep selection callable (optional)
+static PyObject *Reader_read(ReaderObject *self, PyObject *args)
+{
+	const char *fileName;
+	PyObject *list, *select = Py_None;
+
+	if(!PyArg_ParseTuple(args, "s|O", &fileName, &select)) return NULL;
+	if(acquireReader(self)) return NULL;
+
+	list = readFile(&self->buffers, &self->cache, fileName, self->debugMode,
+					select, self->numOfThreads);
+	trimScratch(self);
+	self->busy = 0;
+	if(list != NULL) return list;
+	if(PyErr_Occurred()) return NULL;	// Propagate Python exceptions.
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+// Check that an array can receive a decoded vector. Returns:
+//   0 ... array is suitable
+//   1 ... array is not suitable, Python exception set
+// Arguments:
+//   array   ... output array
+//   typeNum ... required NumPy type of array elements
+//   length  ... required minimal length
+int checkOutputArray(PyObject *array, int typeNum, npy_intp length)
+{
+	if(!PyArray_Check(array) || PyArray_NDIM((PyArrayObject *)array) != 1 ||
+	   PyArray_TYPE((PyArrayObject *)array) != typeNum ||
+	   !PyArray_ISWRITEABLE((PyArrayObject *)array))
 	{
-		if(debugMode) fprintf(debugFile,
-							  "HSpiceRead: failed to create tuple with read data.\n");
-		goto failed;
+		PyErr_SetString(PyExc_TypeError, typeNum == NPY_CDOUBLE ?
+						"output must be a writeable 1-D complex128 array" :
+						"output must be a writeable 1-D float64 array");
+		return 1;
 	}
-	Py_XDECREF(date);
-	date = NULL;
-	Py_XDECREF(title);
-	title = NULL;
-	Py_XDECREF(scale);
-	scale = NULL;
-	Py_XDECREF(sweeps);
-	sweeps = NULL;
+	if(PyArray_DIM((PyArrayObject *)array, 0) < length)
+	{
+		PyErr_SetString(PyExc_ValueError, "output array is too short");
+		return 1;
+	}
+	return 0;
+}
 
-	list = PyList_New(0);	// Create an empty list.
-	if(list == NULL)
+// Read a file into caller-provided arrays. Nothing is allocated once the
+// scratch space is large enough and the header layout is cached. Returns a
+// list with the number of rows read for every table. Arguments:
+//   fileName    ... name of the file
+//   out         ... sequence with one dictionary per table mapping vector
+//                   names to float64 (complex128 for complex vectors) arrays;
+//                   vectors that are not in a dictionary are not decoded
+//   sweepValues ... float64 array receiving sweep parameter values (optional)
+static PyObject *Reader_readInto(ReaderObject *self, PyObject *args)
+{
+	const char *fileName;
+	int i, num, numOfColumns, debugMode = self->debugMode;
+	struct FileHeader header;
+	FILE *f = NULL;
+	PyObject *out, *sweepValues = Py_None, *seq = NULL, *counts = NULL;
+
+	if(!PyArg_ParseTuple(args, "sO|O", &fileName, &out, &sweepValues))
+		return NULL;
+	if(acquireReader(self)) return NULL;
+
+	if(debugMode) fprintf(debugFile, "HSpiceRead: reading file %s.\n", fileName);
+
+	f = fopen(fileName, "rb");	// Open the file.
+	if(f == NULL)
 	{
 		if(debugMode)
-			fprintf(debugFile, "HSpiceRead: failed to create return list.\n");
-		goto failed;
+			fprintf(debugFile, "HSpiceRead: cannot open file %s.\n", fileName);
+		PyErr_SetFromErrnoWithFilename(PyExc_OSError, fileName);
+		goto readIntoFailed;
 	}
 
-	num = PyList_Append(list, tuple);	// Insert tuple into return list.
-	if(num)
+	// Parse file header.
+	num = readPooledHeader(f, debugMode, fileName, &self->buffers, &self->cache,
+						   &header);
+	if(num) goto readIntoFailed;
+	num = getHeaderKeys(debugMode, &self->cache);
+	if(num) goto readIntoFailed;
+	numOfColumns = getNumOfColumns(&header);
+
+	seq = PySequence_Fast(out, "out must be a sequence of dictionaries");
+	if(seq == NULL) goto readIntoFailed;
+	if(PySequence_Fast_GET_SIZE(seq) != header.sweepSize)
 	{
-		if(debugMode) fprintf(debugFile,
-							  "HSpiceRead: failed to append tuple to return list.\n");
-		goto failed;
+		PyErr_Format(PyExc_ValueError, "file has %d tables", header.sweepSize);
+		goto readIntoFailed;
 	}
-	Py_XDECREF(tuple);
+	if(sweepValues != Py_None &&
+	   checkOutputArray(sweepValues, NPY_DOUBLE, header.sweepSize))
+		goto readIntoFailed;
 
-	return list;
+	counts = PyList_New(header.sweepSize);
+	if(counts == NULL) goto readIntoFailed;
 
-failed:	// Error occured. Close open file, relese memory and python references.
-	if (f)
-		fclose(f);
-	PyMem_Free(buf);
-	Py_XDECREF(date);
-	Py_XDECREF(title);
-	Py_XDECREF(scale);
-	PyMem_Free(name);
-	Py_XDECREF(sweep);
-	Py_XDECREF(sweepValues);
-	Py_XDECREF(dataList);
-	PyMem_Free(tmpArray);
-	PyMem_Free(faPtr);
-	Py_XDECREF(sweeps);
-	Py_XDECREF(tuple);
-	Py_XDECREF(list);
-	return Py_None;
+	for(i = 0; i < header.sweepSize; i++)	// Read i-th table.
+	{
+		size_t count;
+		npy_intp rows, j;
+		Py_ssize_t pos = 0;
+		float *rawData;
+		PyObject *data = PySequence_Fast_GET_ITEM(seq, i), *key, *array, *rowCount;
+
+		if(!PyDict_Check(data))
+		{
+			PyErr_SetString(PyExc_TypeError, "out must be a sequence of dictionaries");
+			goto readIntoFailed;
+		}
+
+		num = readRawTable(f, debugMode, fileName, &self->buffers, &count);
+		if(num) goto readIntoFailed;
+		rawData = self->buffers.rawData;
+		if(header.sweep != NULL)	// Save sweep value.
+		{
+			if(sweepValues != Py_None)
+				*(npy_double *)PyArray_GETPTR1((PyArrayObject *)sweepValues, i) =
+					rawData[0];
+			rawData = rawData + 1;
+			count = count - 1;
+		}
+		rows = (count - 1) / numOfColumns;
+
+		while(PyDict_Next(data, &pos, &key, &array))	// Fill requested vectors.
+		{
+			PyObject *index = PyDict_GetItem(self->cache.index, key);
+			int vector, column;
+			char *dst;
+			npy_intp stride;
+			float *src;
+			if(index == NULL)
+			{
+				PyErr_SetObject(PyExc_KeyError, key);
+				goto readIntoFailed;
+			}
+			vector = (int)PyLong_AsLong(index);
+			column = getVectorColumn(&header, vector);
+			if(checkOutputArray(array, isComplexVector(&header, vector) ?
+								NPY_CDOUBLE : NPY_DOUBLE, rows))
+				goto readIntoFailed;
+
+			dst = PyArray_BYTES((PyArrayObject *)array);
+			stride = PyArray_STRIDE((PyArrayObject *)array, 0);
+			src = rawData + column;
+			if(isComplexVector(&header, vector)) for(j = 0; j < rows; j++)
+			{
+				((npy_cdouble *)dst)->real = src[0];
+				((npy_cdouble *)dst)->imag = src[1];
+				dst = dst + stride;
+				src = src + numOfColumns;
+			}
+			else for(j = 0; j < rows; j++)
+			{
+				*((npy_double *)dst) = *src;
+				dst = dst + stride;
+				src = src + numOfColumns;
+			}
+		}
+
+		rowCount = PyLong_FromSsize_t(rows);
+		if(rowCount == NULL) goto readIntoFailed;
+		PyList_SET_ITEM(counts, i, rowCount);
+	}
+
+	fclose(f);
+	Py_XDECREF(seq);
+	trimScratch(self);
+	self->busy = 0;
+	return counts;
+
+readIntoFailed:
+	trimScratch(self);
+	self->busy = 0;
+	if(f) fclose(f);
+	Py_XDECREF(seq);
+	Py_XDECREF(counts);
+	if(PyErr_Occurred()) return NULL;	// Propagate Python exceptions.
+	PyErr_Format(PyExc_ValueError, "failed to read file %s", fileName);
+	return NULL;
 }
+
+static PyMethodDef Reader_methods[] =
+{
+	{"read", (PyCFunction)Reader_read, METH_VARARGS},
+	{"read_into", (PyCFunction)Reader_readInto, METH_VARARGS},
+	{"clear", (PyCFunction)Reader_clear, METH_NOARGS},
+	{"scratch_size", (PyCFunction)Reader_scratchSize, METH_NOARGS},
+	{NULL, NULL}	// Marks the end of this structure.
+};
+
+static PyTypeObject ReaderType =
+{
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_hspice_read.Reader",
+	.tp_basicsize = sizeof(ReaderObject),
+	.tp_dealloc = (destructor)Reader_dealloc,
+	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+	.tp_methods = Reader_methods,
+	.tp_init = (initproc)Reader_init,
+	.tp_new = PyType_GenericNew,
+};
@@ -1,4 +1,22 @@
 #include "Python.h"
+#include <errno.h>
+#include "arrow_c_data.h"
+#ifdef LINUX
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// File positions are 64-bit on all platforms so that tables beyond 2GB can
+// be located and skipped.
+#ifdef LINUX
+typedef off_t FileOffset;
+#define fileSeek fseeko
+#define fileTell ftello
+#else
+typedef __int64 FileOffset;
+#define fileSeek _fseeki64
+#define fileTell _ftelli64
+#endif
 
 // Structure for fast vector access
 struct FastArray
@@ -9,8 +27,217 @@ struct FastArray
 	Py_ssize_t length;
 };
 
-// Python callable function
+// Parsed file header. Strings point into buf.
+struct FileHeader
+{
+	char *buf;				// Header text
+	char **name;			// Vector names without scale
+	char *scale;			// Scale name
+	char *sweep;			// Sweep parameter name, NULL if not swept
+	char *title;
+	char *date;
+	int numOfVectors;		// Number of variables and probes (scale included)
+	int numOfVariables;		// Number of variables (scale included)
+	int type;				// Type of variables with exeption of scale
+	int numOfSweeps;		// Number of sweep parameters (0 or 1)
+	int sweepSize;			// Number of tables
+};
+
+// Header parsing, used by all file readers
+int readFileHeader(FILE *f, int debugMode, const char *fileName,
+				   struct FileHeader *header);
+void freeFileHeader(struct FileHeader *header);
+
+// Scratch space reused between tables and, by Reader objects, between files
+struct ReadBuffers
+{
+	char *buf;				// Header text
+	size_t bufSize;			// Allocated sizes in bytes
+	float *rawData;			// Raw data of one table
+	size_t rawDataSize;
+	PyObject **tmpArray;	// Per vector arrays
+	size_t tmpArraySize;
+	struct FastArray *faPtr;
+	size_t faPtrSize;
+};
+
+// Tokenized vector descriptions of the last read file header
+struct HeaderCache
+{
+	int valid;
+	char *text;				// Vector descriptions as read from the file
+	size_t textSize;		// Allocated sizes in bytes
+	size_t length;			// Length of vector descriptions
+	char *tokens;			// Tokenized copy of vector descriptions
+	size_t tokensSize;
+	char **name;			// Vector names without scale, point into tokens
+	size_t nameSize;
+	char *scale;
+	char *sweep;
+	int numOfVectors;
+	int numOfVariables;
+	int numOfSweeps;
+	int type;
+	PyObject *keys;			// Tuple of vector names, scale first
+	PyObject *index;		// Dictionary of vector indices
+};
+
+// Sketch item with the number of observations it stands for
+struct SketchItem
+{
+	float value;
+	float weight;
+};
+
+// Running statistics of all signals at all scale points
+struct StatsPartial
+{
+	long count;				// Number of folded tables
+	double *mean;			// Per scale point and signal
+	double *m2;				// Sum of squared deviations from mean
+	double *min;
+	double *max;
+	struct SketchItem *item;	// Quantile sketch, sketchSize items per point
+	int *size;				// Number of sketch items per point
+};
+
+// State of a statistics computation, shared by all partial statistics
+struct StatsJob
+{
+	const char *fileName;
+	int debugMode;
+	struct FileHeader *header;
+	FileOffset *offset;			// Table positions
+	int numOfSignals;
+	int *column;			// Signal positions within a row
+	int *isComplex;
+	double *scale;			// Scale of the first table
+	npy_intp rows;
+	int numOfQuantiles;
+	double *quantile;
+	int sketchSize;			// Quantile sketch items per point
+	int numOfPartials;
+	struct StatsPartial *partial;
+	int *error;				// Per table results
+};
+
+// Arrow stream export of a file. Everything is allocated with the raw
+// allocator because the stream can be used and released without the GIL.
+struct ArrowExport
+{
+	FILE *f;
+	char *fileName;
+	int debugMode;
+	int sweep;				// File is swept
+	int numOfColumns;		// Numbers in a file row
+	int numOfFields;		// Exported columns
+	char **fieldName;
+	int *fieldColumn;		// Position within a file row, -1 for sweep value
+	int sweepSize;
+	FileOffset *offset;			// Table positions
+	size_t *tableSize;		// Numbers in every table
+	struct ReadBuffers buffers;	// Raw data of one table
+	int next;				// Next table to export
+	char lastError[128];
+};
+
+// Python Reader object keeping scratch space between reads
+typedef struct
+{
+	PyObject_HEAD
+	int debugMode;
+	int numOfThreads;		// Threads for decoding large tables
+	size_t maxScratch;		// Scratch space kept between reads, 0 for no limit
+	int busy;				// A read is in progress
+	struct ReadBuffers buffers;
+	struct HeaderCache cache;
+} ReaderObject;
+
+// Set of independent tasks shared by worker threads
+struct ParallelJob
+{
+	void (*task)(void *context, int index);
+	void *context;
+	int numOfTasks;
+	int next;				// Index of the next task to run
+#ifdef LINUX
+	pthread_mutex_t lock;
+#endif
+};
+int getNumOfThreads(int requested, int numOfTasks);
+void runParallel(int numOfThreads, int numOfTasks,
+				 void (*task)(void *context, int index), void *context);
+
+// Row ranges of one table decoded by worker threads
+struct DecodeJob
+{
+	float *rawData;			// First number of the first row
+	struct FastArray *faPtr;	// Output arrays, one per vector
+	int numOfVectors;
+	int numOfVariables;
+	int type;
+	int numOfColumns;		// Numbers in one row
+	npy_intp rows;
+	npy_intp rowsPerTask;
+};
+
+// Table reader holding only one data block in memory
+struct TableStream
+{
+	FILE *f;
+	const char *fileName;
+	int debugMode;
+	float *buf;				// Current block
+	size_t size;			// Allocated size of buf in numbers
+	size_t count;			// Number of numbers in current block
+	size_t pos;				// Position of next number in current block
+	int last;				// Current block is the last one in table
+};
+
+// Table reader interpolating rows to increasing scale points
+struct ScaleFollower
+{
+	FILE *f;
+	struct TableStream s;
+	int numOfColumns;
+	float *prev;			// Last row before the scale point
+	float *cur;				// First row not before the scale point
+	int haveCur;			// cur holds a row
+	npy_intp rows;			// Number of rows read so far
+};
+
+// State of a comparison of two files, shared by all table comparisons
+struct CompareJob
+{
+	const char *fileNameA;
+	const char *fileNameB;
+	int debugMode;
+	struct FileHeader *headerA;
+	struct FileHeader *headerB;
+	FileOffset *offsetA;			// Table positions
+	FileOffset *offsetB;
+	int numOfSignals;
+	int *columnA;			// Signal positions within a row
+	int *columnB;
+	int *isComplex;
+	double rtol;
+	double atol;
+	double *sweepValue;		// Per table results
+	int *error;
+	double *maxError;		// Per table and signal results
+	double *firstFailure;
+	int *failed;
+	double *sweepValueB;	// Per table sweep values of the second file
+	double *scaleRange;		// Per table first and last scale points of A and B
+	npy_intp *rows;			// Per table row counts of A and B
+};
+
+// Python callable functions
 static PyObject *HSpiceRead(PyObject *self, PyObject *args);
+static PyObject *HSpiceCompare(PyObject *self, PyObject *args);
+static PyObject *HSpiceStats(PyObject *self, PyObject *args);
+static PyObject *HSpiceArrow(PyObject *self, PyObject *args);
+static PyTypeObject ReaderType;
 
 #ifdef LINUX
 #define __declspec(a) extern
@@ -0,0 +1,108 @@
+"""
+Writer of HSPICE binary post files (version 9601) for tests. 
+
+Run the tests from the top directory after building the extension in place::
+
+	python setup.py build_ext --inplace
+	python -m unittest discover tests
+
+Tests of tables over 8GB (test_large.py) run only if the environment 
+variable HSPICEFILE_LARGE_TESTS is set. 
+"""
+
+import os, sys, struct
+from numpy import asarray, concatenate, float32
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+
+def block(payload):
+	"""
+	Returns *payload* bytes framed as one block with header and trailer. 
+	"""
+	return (struct.pack('<4i', 4, 0, 4, len(payload))+payload+
+		struct.pack('<i', len(payload)))
+
+def header(names, sweep=None, sweep_size=0, ac=False):
+	"""
+	Returns the header block for vectors *names* (scale first). *sweep* is 
+	the name of the swept parameter and *sweep_size* the number of tables. 
+	If *ac* is ``True`` all vectors but the scale are complex. 
+	"""
+	text=bytearray(b' '*256)
+	text[0:4]=b'%4d' % len(names)
+	text[4:8]=b'%4d' % 0
+	text[8:12]=b'%4d' % (1 if sweep else 0)
+	text[16:20]=b'9601'
+	text[24:32]=b'testfile'
+	text[88:112]=b'01/01/2020 00:00:00     '
+	if sweep:
+		text[176:186]=b'%10d' % sweep_size
+	types=['2' if ac else '1']+['1']*(len(names)-1)
+	text=bytes(text)+' '.join(types+list(names)).encode()
+	if sweep:
+		text=text+b' '+sweep.encode()
+	return block(text+b' $&%#    ')
+
+def write(filename, names, tables, sweep=None, sweep_values=None, ac=False, 
+	block_size=4096):
+	"""
+	Writes a post file with vectors *names* (scale first). *tables* is a 
+	list of 2-D arrays with one row per scale point in file column order (a 
+	complex vector takes two columns). *sweep_values* lists the values of 
+	the swept parameter *sweep*, one per table. Data is split into blocks of 
+	*block_size* numbers. 
+	"""
+	f=open(filename, 'wb')
+	f.write(header(names, sweep, len(tables), ac))
+	for i, table in enumerate(tables):
+		data=asarray(table, dtype='<f4').ravel()
+		if sweep:
+			data=concatenate([asarray([sweep_values[i]], '<f4'), data])
+		data=concatenate([data, asarray([1e30], '<f4')]).tobytes()
+		for pos in range(0, len(data), block_size*4):
+			f.write(block(data[pos:pos+block_size*4]))
+	f.close()
+
+class SparseTable(object):
+	"""
+	Table of *rows* rows with *columns* numbers each for :func:`write`. Only 
+	the first rows (*head*) and the last rows (*tail*) are given, all other 
+	numbers are zero and are not written, so on file systems with sparse 
+	file support a huge table takes almost no space. 
+	"""
+	def __init__(self, rows, columns, head=None, tail=None):
+		self.rows=rows
+		self.columns=columns
+		self.head=asarray([] if head is None else head, dtype='<f4').ravel()
+		self.tail=asarray([] if tail is None else tail, dtype='<f4').ravel()
+
+def write_sparse(filename, names, tables, sweep=None, sweep_values=None, 
+	block_size=1<<26):
+	"""
+	Writes a post file like :func:`write`. Members of *tables* can also be 
+	:class:`SparseTable` objects. 
+	"""
+	f=open(filename, 'wb')
+	f.write(header(names, sweep, len(tables), ac=False))
+	for i, table in enumerate(tables):
+		if not isinstance(table, SparseTable):
+			table=SparseTable(len(table), len(names), head=table)
+		head=table.head
+		if sweep:
+			head=concatenate([asarray([sweep_values[i]], '<f4'), head])
+		tail=concatenate([table.tail, asarray([1e30], '<f4')])
+		count=(1 if sweep else 0)+table.rows*table.columns+1
+		for start in range(0, count, block_size):
+			end=min(start+block_size, count)
+			f.write(struct.pack('<4i', 4, 0, 4, (end-start)*4))
+			data=f.tell()-start*4
+			# Known numbers overlapping this block, holes are skipped. 
+			for first, values in ((0, head), (count-len(tail), tail)):
+				lo=max(start, first)
+				hi=min(end, first+len(values))
+				if lo < hi:
+					f.seek(data+lo*4)
+					f.write(values[lo-first:hi-first].tobytes())
+			f.seek(data+end*4)
+			f.write(struct.pack('<i', (end-start)*4))
+	f.close()
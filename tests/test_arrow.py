@@ -0,0 +1,89 @@
+"""
+Tests of the Arrow export of hspice_arrow() against hspice_read(). 
+"""
+
+import os, tempfile, unittest
+import numpy
+import postfile
+from hspicefile import hspice_read, hspice_arrow
+
+try:
+	import pyarrow
+except ImportError:
+	pyarrow=None
+
+@unittest.skipIf(pyarrow is None, 'pyarrow is not installed')
+class ArrowTest(unittest.TestCase):
+	values=[10, 20, 30]
+	
+	@classmethod
+	def setUpClass(cls):
+		cls.dir=tempfile.TemporaryDirectory()
+		rng=numpy.random.RandomState(2)
+		# Tables of different lengths, the last one spans several decoded 
+		# row ranges. 
+		lengths=[37, 1, 70000]
+		cls.real=os.path.join(cls.dir.name, 'real.tr0')
+		postfile.write(cls.real, ['time', 'v(a', 'v(b'], 
+			[rng.rand(n, 3) for n in lengths], sweep='temp', 
+			sweep_values=cls.values, block_size=13)
+		cls.ac=os.path.join(cls.dir.name, 'ac.ac0')
+		postfile.write(cls.ac, ['hertz', 'v(a', 'v(b'], 
+			[rng.rand(n, 5) for n in lengths], sweep='temp', 
+			sweep_values=cls.values, ac=True, block_size=13)
+		cls.plain=os.path.join(cls.dir.name, 'plain.tr0')
+		postfile.write(cls.plain, ['time', 'v(a'], [rng.rand(100, 2)])
+	
+	@classmethod
+	def tearDownClass(cls):
+		cls.dir.cleanup()
+	
+	def batches(self, filename, **kwargs):
+		return pyarrow.table(hspice_arrow(filename, **kwargs)).to_batches()
+	
+	def test_schema(self):
+		table=pyarrow.table(hspice_arrow(self.real))
+		self.assertEqual(table.column_names, ['temp', 'time', 'a', 'b'])
+		for field in table.schema:
+			self.assertEqual(field.type, pyarrow.float64())
+		table=pyarrow.table(hspice_arrow(self.real, sweep_column=False))
+		self.assertEqual(table.column_names, ['time', 'a', 'b'])
+		table=pyarrow.table(hspice_arrow(self.ac))
+		self.assertEqual(table.column_names, ['temp', 'hertz', 
+			'real(a)', 'imag(a)', 'real(b)', 'imag(b)'])
+		table=pyarrow.table(hspice_arrow(self.plain))
+		self.assertEqual(table.column_names, ['time', 'a'])
+	
+	def test_real(self):
+		tables=hspice_read(self.real)[0][0][2]
+		batches=self.batches(self.real)
+		self.assertEqual(len(batches), len(tables))
+		for batch, table, value in zip(batches, tables, self.values):
+			self.assertEqual(batch.num_rows, len(table['time']))
+			self.assertTrue((batch.column('temp').to_numpy() == value).all())
+			for key in ['time', 'a', 'b']:
+				self.assertTrue((batch.column(key).to_numpy() == table[key]).all())
+	
+	def test_ac(self):
+		tables=hspice_read(self.ac)[0][0][2]
+		batches=self.batches(self.ac, sweep_column=False)
+		self.assertEqual(len(batches), len(tables))
+		for batch, table in zip(batches, tables):
+			self.assertEqual(batch.num_rows, len(table['hertz']))
+			self.assertTrue((batch.column('hertz').to_numpy() == 
+				table['hertz']).all())
+			for key in ['a', 'b']:
+				self.assertTrue((batch.column('real(%s)' % key).to_numpy() == 
+					table[key].real).all())
+				self.assertTrue((batch.column('imag(%s)' % key).to_numpy() == 
+					table[key].imag).all())
+	
+	def test_not_swept(self):
+		table=hspice_read(self.plain)[0][0][2][0]
+		batches=self.batches(self.plain)
+		self.assertEqual(len(batches), 1)
+		for key in ['time', 'a']:
+			self.assertTrue((batches[0].column(key).to_numpy() == table[key]).all())
+
+if __name__=='__main__':
+	unittest.main()
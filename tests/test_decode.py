@@ -0,0 +1,80 @@
+"""
+Tests of the parallel decoding of large tables. Tables of more than 2^20 
+numbers are split into row ranges that are decoded on several threads, the 
+result must not depend on the number of threads. 
+"""
+
+import os, tempfile, unittest
+import numpy
+import postfile
+from hspicefile import hspice_read, Reader
+
+class ParallelDecodeTest(unittest.TestCase):
+	threads=(2, 3, 8)
+	
+	@classmethod
+	def setUpClass(cls):
+		cls.dir=tempfile.TemporaryDirectory()
+		cls.rng=numpy.random.RandomState(3)
+	
+	@classmethod
+	def tearDownClass(cls):
+		cls.dir.cleanup()
+	
+	def write(self, name, names, tables, **kwargs):
+		filename=os.path.join(self.dir.name, name)
+		tables=[self.rng.rand(rows, columns) for rows, columns in tables]
+		postfile.write(filename, names, tables, block_size=65537, **kwargs)
+		return filename, tables
+	
+	def check(self, filename, tables, complex_columns=False):
+		"""
+		Reads *filename* with one and with more threads and checks the 
+		results against each other and against the written *tables*. 
+		"""
+		reference=hspice_read(filename, threads=1)[0][0][2]
+		results=[hspice_read(filename, threads=threads)[0][0][2] 
+			for threads in self.threads]
+		results.append(Reader(threads=4).read(filename)[0][0][2])
+		for result in results:
+			self.assertEqual(len(result), len(reference))
+			for table, expected in zip(result, reference):
+				self.assertEqual(list(table.keys()), list(expected.keys()))
+				for key in table:
+					self.assertEqual(table[key].dtype, expected[key].dtype)
+					self.assertTrue((table[key] == expected[key]).all(), key)
+		for table, written in zip(reference, tables):
+			written=written.astype(numpy.float32)
+			column=0
+			for key in table:
+				if complex_columns and column > 0:
+					value=written[:, column]+1j*written[:, column+1]
+					column=column+2
+				else:
+					value=written[:, column]
+					column=column+1
+				self.assertTrue((table[key] == value).all(), key)
+	
+	def test_real(self):
+		# 21846 rows per range, the last range is shorter. 
+		self.check(*self.write('real.tr0', ['time', 'v(a', 'v(b'], 
+			[(400001, 3)]))
+	
+	def test_ac(self):
+		# Five columns, complex vectors take two. 
+		self.check(*self.write('ac.ac0', ['hertz', 'v(a', 'v(b'], 
+			[(250003, 5)], ac=True), complex_columns=True)
+	
+	def test_swept(self):
+		# Large tables mixed with a small one that is decoded on one thread. 
+		self.check(*self.write('swept.tr0', ['time', 'v(a', 'v(b'], 
+			[(350017, 3), (100, 3), (420000, 3)], sweep='temp', 
+			sweep_values=[1, 2, 3]))
+	
+	def test_uneven(self):
+		# 16385 rows per range, the last range holds a single row. 
+		self.check(*self.write('uneven.tr0', ['time', 'v(a', 'v(b', 'v(c'], 
+			[(16385*16+1, 4)]))
+
+if __name__=='__main__':
+	unittest.main()
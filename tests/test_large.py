@@ -0,0 +1,119 @@
+"""
+Tests of tables with more than 2^31 numbers (over 8GB) in sparse files. 
+They write two 8.6GB sparse files and stream through them, which takes a 
+minute or two, so they only run if the environment variable 
+HSPICEFILE_LARGE_TESTS is set:: 
+
+	HSPICEFILE_LARGE_TESTS=1 python -m unittest discover tests -p test_large.py
+
+Decoding the table with read_into() needs about 16GB of memory, decoding it 
+with hspice_read() about 32GB. These tests are skipped on smaller machines. 
+"""
+
+import os, tempfile, unittest
+import numpy
+import postfile
+from hspicefile import hspice_read, hspice_compare, Reader
+
+# One row of three numbers more than 2^31 numbers
+rows=(1<<31)//3+1
+tail=numpy.array([[1, 1, 2], [2, 3, 4], [3, 5, 6]], dtype=numpy.float32)
+small=numpy.array([[0, 7, 8], [1, 9, 10]], dtype=numpy.float32)
+
+def available_memory():
+	"""
+	Returns the available memory in bytes, 0 if unknown. 
+	"""
+	try:
+		for line in open('/proc/meminfo'):
+			if line.startswith('MemAvailable:'):
+				return int(line.split()[1])*1024
+	except OSError:
+		pass
+	return 0
+
+def write(filename, tail):
+	"""
+	Writes a file with a huge first table ending with *tail* rows and a 
+	small second table. The scale of the huge table is zero up to the tail 
+	so it does not decrease. 
+	"""
+	postfile.write_sparse(filename, ['time', 'a', 'b'], 
+		[postfile.SparseTable(rows, 3, tail=tail), small], 
+		sweep='temp', sweep_values=[10, 20])
+
+@unittest.skipUnless(os.environ.get('HSPICEFILE_LARGE_TESTS'), 
+	'set HSPICEFILE_LARGE_TESTS=1 to run tests of tables over 8GB')
+class LargeTableTest(unittest.TestCase):
+	@classmethod
+	def setUpClass(cls):
+		cls.dir=tempfile.TemporaryDirectory()
+		cls.file_a=os.path.join(cls.dir.name, 'a.tr0')
+		write(cls.file_a, tail)
+		st=os.stat(cls.file_a)
+		if st.st_blocks*512 > st.st_size//2:
+			cls.dir.cleanup()
+			raise unittest.SkipTest('file system has no sparse file support')
+	
+	@classmethod
+	def tearDownClass(cls):
+		cls.dir.cleanup()
+	
+	def test_size(self):
+		self.assertGreater(os.path.getsize(self.file_a), 8<<30)
+	
+	def test_skip(self):
+		result=hspice_read(self.file_a, sweeps=[1])
+		sweep, values, data=result[0][0]
+		self.assertEqual(list(values), [20])
+		self.assertEqual(len(data), 1)
+		self.assertTrue((data[0]['time'] == small[:, 0]).all())
+		self.assertTrue((data[0]['b'] == small[:, 2]).all())
+	
+	def test_compare(self):
+		changed=tail.copy()
+		changed[1, 1]=3.5
+		file_b=os.path.join(self.dir.name, 'b.tr0')
+		write(file_b, changed)
+		try:
+			passed, values, tables=hspice_compare(self.file_a, file_b)
+		finally:
+			os.remove(file_b)
+		self.assertFalse(passed)
+		self.assertEqual(list(values), [10, 20])
+		ok, errors, mismatch=tables[0]
+		self.assertFalse(ok)
+		self.assertIsNone(mismatch)
+		self.assertAlmostEqual(errors['a'][0], 0.5)
+		self.assertEqual(errors['a'][1], 2.0)
+		self.assertIsNone(errors['b'][1])
+		self.assertTrue(tables[1][0])
+	
+	@unittest.skipIf(available_memory() < 16<<30, 'needs 16GB of memory')
+	def test_decode_into(self):
+		out=[{'a': numpy.zeros(rows)}, {'a': numpy.zeros(2)}]
+		sweep_values=numpy.zeros(2)
+		counts=Reader().read_into(self.file_a, out, sweep_values)
+		self.assertEqual(counts, [rows, 2])
+		self.assertEqual(list(sweep_values), [10, 20])
+		a=out[0]['a']
+		self.assertTrue((a[-3:] == tail[:, 1]).all())
+		self.assertTrue((a[:-3] == 0).all())
+		self.assertTrue((out[1]['a'] == small[:, 1]).all())
+	
+	@unittest.skipIf(available_memory() < 32<<30, 'needs 32GB of memory')
+	def test_decode(self):
+		# Goes through readTable() and the parallel decoding of row ranges 
+		# beyond 2^31 numbers. 
+		sweep, values, data=hspice_read(self.file_a)[0][0]
+		self.assertEqual(list(values), [10, 20])
+		table=data[0]
+		for i, key in enumerate(['time', 'a', 'b']):
+			self.assertEqual(len(table[key]), rows)
+			self.assertTrue((table[key][-3:] == tail[:, i]).all())
+			self.assertEqual(table[key][-4], 0)
+			self.assertEqual(table[key][0], 0)
+		self.assertTrue((data[1]['a'] == small[:, 1]).all())
+
+if __name__=='__main__':
+	unittest.main()
@@ -0,0 +1,114 @@
+"""
+Tests of the Reader class: reusing the header layout between files, 
+reading into preallocated arrays and releasing scratch space. 
+"""
+
+import os, tempfile, unittest
+import numpy
+import postfile
+from hspicefile import hspice_read, Reader
+
+class ReaderTest(unittest.TestCase):
+	@classmethod
+	def setUpClass(cls):
+		cls.dir=tempfile.TemporaryDirectory()
+		rng=numpy.random.RandomState(1)
+		scale=numpy.linspace(0, 1, 40)
+		cls.names={}
+		cls.tables={}
+		for name, names in [
+			('first', ['time', 'v(a', 'v(b']), 
+			('second', ['time', 'v(a', 'v(b']), 
+			('other', ['time', 'v(c', 'i(vdd', 'v(d'])
+		]:
+			cls.names[name]=names
+			cls.tables[name]=[
+				numpy.column_stack([scale]+[rng.rand(40) for i in names[1:]]) 
+				for value in range(3)
+			]
+			postfile.write(cls.path(name), names, cls.tables[name], 
+				sweep='temp', sweep_values=[25, 50, 75], block_size=53)
+		cls.big=numpy.column_stack([numpy.linspace(0, 1, 20000), 
+			rng.rand(20000), rng.rand(20000)])
+		postfile.write(cls.path('big'), ['time', 'v(a', 'v(b'], [cls.big])
+	
+	@classmethod
+	def tearDownClass(cls):
+		cls.dir.cleanup()
+	
+	@classmethod
+	def path(cls, name):
+		return os.path.join(cls.dir.name, name+'.tr0')
+	
+	def check(self, reader, name):
+		"""
+		Reads file *name* with *reader* and checks the result against 
+		hspice_read() and against the written tables. 
+		"""
+		result=reader.read(self.path(name))
+		expected=hspice_read(self.path(name))
+		self.assertEqual(result[0][0][0], 'temp')
+		self.assertEqual(list(result[0][0][1]), [25, 50, 75])
+		self.assertEqual(result[0][1:], expected[0][1:])
+		for i, table in enumerate(result[0][0][2]):
+			self.assertEqual(sorted(table.keys()), 
+				sorted(expected[0][0][2][i].keys()))
+			for key in table:
+				self.assertTrue((table[key] == expected[0][0][2][i][key]).all())
+			written=self.tables[name][i]
+			for j, key in enumerate(expected[0][0][2][i]):
+				self.assertTrue((table[key] == 
+					written[:, j].astype(numpy.float32)).all())
+		return result
+	
+	def test_layout_change(self):
+		reader=Reader()
+		for name, keys in [
+			('first', ['time', 'a', 'b']), 
+			('second', ['time', 'a', 'b']), 
+			('other', ['time', 'c', 'i(vdd', 'd']), 
+			('first', ['time', 'a', 'b'])
+		]:
+			result=self.check(reader, name)
+			for table in result[0][0][2]:
+				self.assertEqual(list(table.keys()), keys)
+			self.assertEqual(result[0][1], 'time')
+	
+	def test_read_into(self):
+		reader=Reader()
+		expected=hspice_read(self.path('other'))[0][0][2]
+		keys=list(expected[0].keys())
+		out=[{key: numpy.zeros(50) for key in keys[1:3]} for i in range(3)]
+		values=numpy.zeros(3)
+		counts=reader.read_into(self.path('other'), out, values)
+		self.assertEqual(counts, [40, 40, 40])
+		self.assertEqual(list(values), [25, 50, 75])
+		for table, reference in zip(out, expected):
+			for key in keys[1:3]:
+				self.assertTrue((table[key][:40] == reference[key]).all())
+				self.assertTrue((table[key][40:] == 0).all())
+		self.assertRaises(Exception, reader.read_into, self.path('other'), 
+			[{keys[1]: numpy.zeros(10)}]*3)
+	
+	def test_clear(self):
+		reader=Reader()
+		reader.read(self.path('big'))
+		self.assertTrue(reader.scratch_size() >= self.big.size*4)
+		reader.clear()
+		self.assertEqual(reader.scratch_size(), 0)
+		self.check(reader, 'first')
+	
+	def test_max_scratch(self):
+		reader=Reader(max_scratch=1<<16)
+		self.check(reader, 'first')
+		kept=reader.scratch_size()
+		self.assertTrue(0 < kept <= 1<<16)
+		data=reader.read(self.path('big'))[0][0][2][0]
+		self.assertTrue((data['time'] == 
+			self.big[:, 0].astype(numpy.float32)).all())
+		self.assertEqual(reader.scratch_size(), 0)
+		self.check(reader, 'first')
+		self.assertEqual(reader.scratch_size(), kept)
+
+if __name__=='__main__':
+	unittest.main()
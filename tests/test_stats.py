@@ -0,0 +1,82 @@
+"""
+Tests of hspice_stats() quantiles against numpy.quantile() and of the 
+memory used by the quantile sketches. 
+"""
+
+import os, tempfile, tracemalloc, unittest
+import numpy
+import postfile
+from hspicefile import hspice_stats
+
+class QuantileTest(unittest.TestCase):
+	quantiles=(0.05, 0.5, 0.95)
+	threads=(1, 2, 8, 32)
+	
+	def setUp(self):
+		self.dir=tempfile.TemporaryDirectory()
+	
+	def tearDown(self):
+		self.dir.cleanup()
+	
+	def monte_carlo(self, samples, seed, points=100):
+		"""
+		Writes *samples* tables of N(0,1) values on a common scale. Returns 
+		the file name and the values of vector ``a`` (samples x points). 
+		"""
+		rng=numpy.random.RandomState(seed)
+		scale=numpy.linspace(0, 1, points)
+		values=rng.randn(samples, points).astype(numpy.float32)
+		tables=[numpy.column_stack([scale, v]) for v in values]
+		filename=os.path.join(self.dir.name, 'mc%d.tr0' % samples)
+		postfile.write(filename, ['time', 'a'], tables, sweep='mc', 
+			sweep_values=range(samples))
+		return filename, values.astype(numpy.float64)
+	
+	def check(self, samples, tolerance):
+		filename, values=self.monte_carlo(samples, samples)
+		expected=numpy.quantile(values, self.quantiles, axis=0)
+		for threads in self.threads:
+			result=hspice_stats(filename, quantiles=self.quantiles, 
+				threads=threads)
+			self.assertEqual(result[2], samples)
+			q=result[3]['a']['quantiles']
+			error=numpy.abs(q-expected).mean(axis=1)
+			self.assertTrue((error <= tolerance).all(), 
+				'threads=%d error=%s' % (threads, error))
+			self.assertTrue(numpy.allclose(result[3]['a']['min'], values.min(0)))
+			self.assertTrue(numpy.allclose(result[3]['a']['max'], values.max(0)))
+	
+	def test_exact(self):
+		# Sketches hold 32 items per quantile plus 32, so with three 
+		# quantiles up to 128 samples are exact for any number of threads. 
+		self.check(40, 1e-6)
+		self.check(128, 1e-6)
+	
+	def test_sketch(self):
+		# Beyond that they stay within a small fraction of sigma. 
+		self.check(500, 0.06)
+		self.check(3000, 0.06)
+	
+	def peak(self, filename):
+		"""
+		Returns the peak memory traced while computing statistics. 
+		"""
+		tracemalloc.start()
+		try:
+			hspice_stats(filename, quantiles=self.quantiles, threads=1)
+			return tracemalloc.get_traced_memory()[1]
+		finally:
+			tracemalloc.stop()
+	
+	def test_memory(self):
+		# Sketches have a fixed size. Apart from about 20 bytes per table 
+		# for table positions the memory does not grow with the number of 
+		# sweeps. The sketches of 500 points take about 500kB. 
+		small=self.peak(self.monte_carlo(100, 1, 500)[0])
+		large=self.peak(self.monte_carlo(2000, 2, 500)[0])
+		self.assertTrue(small > 500*128*8)
+		self.assertTrue(large-small < 1900*20+16384, 
+			'peak %d bytes for 100 sweeps, %d for 2000' % (small, large))
+
+if __name__=='__main__':
+	unittest.main()
@@ -0,0 +1,76 @@
+"""
+Tests of sweep table selection in hspice_read(). 
+"""
+
+import os, tempfile, unittest
+import numpy
+import postfile
+from hspicefile import hspice_read, sweep_range
+
+class SweepSelectionTest(unittest.TestCase):
+	values=[10, 20, 30, 40, 50]
+	
+	@classmethod
+	def setUpClass(cls):
+		cls.dir=tempfile.TemporaryDirectory()
+		cls.filename=os.path.join(cls.dir.name, 'sweep.tr0')
+		rng=numpy.random.RandomState(0)
+		scale=numpy.linspace(0, 1, 50)
+		cls.tables=[numpy.column_stack([scale, rng.rand(50), rng.rand(50)]) 
+			for value in cls.values]
+		postfile.write(cls.filename, ['time', 'a', 'b'], cls.tables, 
+			sweep='temp', sweep_values=cls.values, block_size=37)
+		cls.full=hspice_read(cls.filename)[0][0]
+	
+	@classmethod
+	def tearDownClass(cls):
+		cls.dir.cleanup()
+	
+	def check(self, sweeps, indices):
+		"""
+		Reads with *sweeps* and checks that tables *indices* of a full read 
+		are returned in the same order. 
+		"""
+		name, values, data=hspice_read(self.filename, sweeps=sweeps)[0][0]
+		self.assertEqual(name, 'temp')
+		self.assertEqual(list(values), [self.full[1][i] for i in indices])
+		self.assertEqual(len(data), len(indices))
+		for table, i in zip(data, indices):
+			self.assertEqual(sorted(table.keys()), sorted(self.full[2][i].keys()))
+			for key in table:
+				self.assertTrue((table[key] == self.full[2][i][key]).all())
+	
+	def test_full(self):
+		self.assertEqual(list(self.full[1]), self.values)
+		self.assertTrue((self.full[2][3]['b'] == 
+			self.tables[3][:, 2].astype(numpy.float32)).all())
+	
+	def test_int(self):
+		self.check(2, [2])
+	
+	def test_negative_int(self):
+		self.check(-1, [4])
+	
+	def test_list_with_duplicates(self):
+		self.check([3, 0, 3], [3, 0, 3])
+	
+	def test_slice(self):
+		self.check(slice(1, None, 2), [1, 3])
+	
+	def test_sweep_range(self):
+		self.check(sweep_range(20, 40), [1, 2, 3])
+	
+	def test_mask(self):
+		self.check(lambda values: values > 35, [3, 4])
+	
+	def test_index_callable(self):
+		self.check(lambda values: [4, 1], [4, 1])
+	
+	def test_out_of_range(self):
+		self.assertRaises(IndexError, hspice_read, self.filename, sweeps=5)
+		self.assertRaises(IndexError, hspice_read, self.filename, sweeps=[0, 7])
+		self.assertRaises(IndexError, hspice_read, self.filename, 
+			sweeps=lambda values: [5])
+
+if __name__=='__main__':
+	unittest.main()